@@ -1,8 +1,9 @@
 #generated by newprogram
 
-#AM_CFLAGS=-Wall -Wextra -O2 -D_GNU_SOURCE=1
-# Set up initially to use GDB, change to optimised afterward.
-AM_CFLAGS=-Wall -Wextra -g -O0 -D_GNU_SOURCE=1
+# Optimisation is chosen at configure time. The default suits GDB,
+# ./configure --enable-release optimises, --enable-lto adds link time
+# optimisation and `make pgo` does a profile guided build.
+AM_CFLAGS=-Wall -Wextra -D_GNU_SOURCE=1 $(OPT_CFLAGS) $(PGO_CFLAGS)
 
 bin_PROGRAMS=exe%s
 
@@ -17,3 +18,17 @@ thr%s_DATA=
 # ensure that man%s and any other config files get put in the tarball.
 # also stops `make distcheck` bringing an error.
 EXTRA_DIST=man%s
+
+# Profile guided build: instrument, run PGO_TRAIN, rebuild using the
+# profile. PGO_TRAIN comes from pgotrain in newprogram's prdata.cfg.
+PGO_CFLAGS=
+PGO_TRAIN=pgo%s
+.PHONY: pgo
+pgo:
+	$(MAKE) $(AM_MAKEFLAGS) clean
+	find . -name '*.gcda' -exec rm -f {} +
+	$(MAKE) $(AM_MAKEFLAGS) PGO_CFLAGS=-fprofile-generate
+	$(PGO_TRAIN)
+	$(MAKE) $(AM_MAKEFLAGS) mostlyclean-compile
+	$(MAKE) $(AM_MAKEFLAGS) \
+		PGO_CFLAGS="-fprofile-use -fprofile-correction"
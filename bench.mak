@@ -0,0 +1,9 @@
+
+# Benchmark harness. `make bench` builds and runs it, pass harness
+# options with eg `make bench BENCH_FLAGS="-r 1000 -c 2"`.
+check_PROGRAMS=bench/bench
+bench_bench_SOURCES=bench/bench.c bench/bench.hdep%s
+BENCH_FLAGS=
+.PHONY: bench
+bench: bench/bench$(EXEEXT)
+	./bench/bench$(EXEEXT) $(BENCH_FLAGS)
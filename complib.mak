@@ -0,0 +1,6 @@
+
+# The components come compiled in libcomponents.a, which newprogram
+# builds once for all projects and again when they change. Their
+# headers are here as ever.
+LDADD=$(srcdir)/libcomponents.a
+EXTRA_DIST+=libcomponents.a
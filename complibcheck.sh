@@ -0,0 +1,47 @@
+#!/bin/sh
+# complibcheck.sh - checks that --gc keeps the versions of
+# libcomponents.a that projects use, however they were linked.
+# usage: complibcheck.sh newprogram
+# For each link mode a project is made with --complib in a scratch
+# HOME, then --gc is run. The version must survive, and the project's
+# libcomponents.a and headers must still be readable and not symlinks.
+# Once the projects are gone --gc must remove the version.
+if [ $# -ne 1 ]; then
+	echo "usage: complibcheck.sh newprogram" >&2
+	exit 2
+fi
+np=`cd \`dirname $1\` && pwd`/`basename $1`
+tmp=`mktemp -d ${TMPDIR:-/tmp}/complibcheck.XXXXXX` || exit 2
+trap 'rm -rf "$tmp"' 0 1 2 15
+HOME=$tmp/home
+export HOME
+comp=$HOME/Documents/Programs/Srclib/Components
+mkdir -p $comp $HOME/Documents/Programs/Srclib/Stubs
+srcdir=`dirname $0`
+cp $srcdir/str.[ch] $srcdir/files.[ch] $comp/
+
+fail() {
+	echo "complibcheck.sh: $*" >&2
+	exit 1
+}
+
+for mode in hard reflink symlink copy; do
+	proj=Cl$mode
+	$np -L -l $mode -B make -d "str.h+c files.h+c" $proj >/dev/null 2>&1 \
+		|| fail "$mode: newprogram failed."
+done
+$np -g >/dev/null || fail "--gc failed."
+lib=`ls -d $HOME/.cache/newprogram/complib/*/libcomponents.a 2>/dev/null`
+[ -n "$lib" ] || fail "the version in use was removed by --gc."
+for mode in hard reflink symlink copy; do
+	dir=$HOME/Documents/Programs/Cl$mode
+	for f in libcomponents.a str.h files.h; do
+		[ -h $dir/$f ] && fail "$mode: $f is a symlink."
+		[ -r $dir/$f ] || fail "$mode: $f is gone."
+	done
+done
+rm -rf $HOME/Documents/Programs/Cl*
+$np -g >/dev/null || fail "--gc failed."
+[ -e "$lib" ] && fail "--gc left a version no project uses."
+echo "complibcheck.sh: ok"
+exit 0
@@ -0,0 +1,322 @@
+/*    daemon.c
+ *
+ * Copyright 2017 Robert L (Bob) Parker rlp1938@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+/* Every request runs in a process forked for it, which takes over the
+ * caller's stdio, working dir and environment and may exit() as
+ * newprogram does, the reply being sent on the way out. What stays warm
+ * in the daemon is whatever the workers inherit: the mapped stubs
+ * bundle with the parsed prdata.cfg and the component locations it
+ * holds.
+ * */
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <time.h>
+#include "daemon.h"
+#include "stubs.h"
+
+#define MAXREQ 65536	// largest request message.
+#define NFDS 4			// stdin, stdout, stderr and working dir.
+
+typedef struct reply_t {	/* what sendreply() needs */
+	int conn;				// to the client.
+	int logfd;				// the daemon's stderr.
+	struct timespec t0;		// when the request came.
+	int argc;
+	char **argv;
+} reply_t;
+
+static char *sockpath(char *buf);
+static int opensocket(struct sockaddr_un *sa);
+static void handle(int conn, request_f run);
+static void sendreply(int status, void *arg);
+static ssize_t getrequest(int conn, char *buf, size_t size, int *fds);
+static double msecs(const struct timespec *t0);
+
+void
+rundaemon(request_f run)
+{ /* Take requests until killed, each one in its own process. */
+	struct sockaddr_un sa;
+	int sock = opensocket(&sa);
+	if (connect(sock, (struct sockaddr *)&sa, sizeof(sa)) == 0) {
+		fprintf(stderr, "A daemon is already listening on %s\n",
+					sa.sun_path);
+		exit(EXIT_FAILURE);
+	}
+	unlink(sa.sun_path);	// left behind by a daemon now dead.
+	mode_t um = umask(077);
+	if (bind(sock, (struct sockaddr *)&sa, sizeof(sa)) == -1) {
+		perror(sa.sun_path);
+		exit(EXIT_FAILURE);
+	}
+	umask(um);
+	if (listen(sock, SOMAXCONN) == -1) {
+		perror("listen");
+		exit(EXIT_FAILURE);
+	}
+	signal(SIGCHLD, SIG_IGN);	// handlers reap themselves.
+	checkstubs();
+	fprintf(stderr, "Listening on %s\n", sa.sun_path);
+	while (1) {
+		int conn = accept4(sock, NULL, NULL, SOCK_CLOEXEC);
+		if (conn == -1) {
+			if (errno != EINTR) perror("accept");
+			continue;
+		}
+		checkstubs();	// picks up edits to the config dir.
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(sock);
+			signal(SIGCHLD, SIG_DFL);
+			handle(conn, run);
+		}
+		if (pid == -1) perror("fork");
+		close(conn);
+	}
+} // rundaemon()
+
+int
+runclient(int argc, char **argv, double *ms)
+{ /* Send the request to the daemon and return its exit status, with
+   * how long the daemon took in *ms, or -1 if there is no daemon to
+   * send it to.
+  */
+	struct sockaddr_un sa;
+	int sock = opensocket(&sa);
+	if (connect(sock, (struct sockaddr *)&sa, sizeof(sa)) == -1) {
+		close(sock);
+		return -1;
+	}
+	char *buf = xmalloc(MAXREQ);
+	size_t len = snprintf(buf, MAXREQ, "%d", argc) + 1;
+	int i, nenv;
+	for (nenv = 0; environ[nenv]; nenv++) ;
+	for (i = 0; i < argc + nenv; i++) {
+		const char *s = (i < argc) ? argv[i] : environ[i - argc];
+		size_t al = strlen(s) + 1;
+		if (len + al > MAXREQ) {
+			fputs("Command line and environment too long for the "
+					"daemon.\n", stderr);
+			exit(EXIT_FAILURE);
+		}
+		memcpy(buf + len, s, al);
+		len += al;
+	}
+	int fds[NFDS] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO, -1 };
+	fds[3] = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fds[3] == -1) {
+		perror(".");
+		exit(EXIT_FAILURE);
+	}
+	union {	// aligned for struct cmsghdr.
+		char buf[CMSG_SPACE(sizeof(fds))];
+		struct cmsghdr align;
+	} ctl;
+	struct iovec iov = { buf, len };
+	struct msghdr msg = {0};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = ctl.buf;
+	msg.msg_controllen = sizeof(ctl.buf);
+	struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+	cm->cmsg_level = SOL_SOCKET;
+	cm->cmsg_type = SCM_RIGHTS;
+	cm->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+	if (sendmsg(sock, &msg, MSG_NOSIGNAL) == -1) {
+		perror("sendmsg");
+		exit(EXIT_FAILURE);
+	}
+	close(fds[3]);
+	free(buf);
+	char reply[128];
+	ssize_t got;
+	do {
+		got = recv(sock, reply, sizeof(reply) - 1, 0);
+	} while (got == -1 && errno == EINTR);
+	close(sock);
+	int status;
+	if (got <= 0) {
+		fputs("The daemon gave no reply.\n", stderr);
+		return EXIT_FAILURE;
+	}
+	reply[got] = 0;
+	if (sscanf(reply, "status %d time %lf ms", &status, ms) != 2) {
+		fprintf(stderr, "Unexpected reply from daemon: %s", reply);
+		return EXIT_FAILURE;
+	}
+	return status;
+} // runclient()
+
+char
+*sockpath(char *buf)
+{ /* Socket path into buf, which must be PATH_MAX. */
+	char *rd = getenv("XDG_RUNTIME_DIR");
+	if (rd && *rd) {
+		sprintf(buf, "%s/newprogram.sock", rd);
+	} else {
+		sprintf(buf, "%s/.cache", getenv("HOME"));
+		newdir(buf, 1);
+		strcat(buf, "/newprogram");
+		newdir(buf, 1);
+		strcat(buf, "/sock");
+	}
+	return buf;
+} // sockpath()
+
+int
+opensocket(struct sockaddr_un *sa)
+{ /* Fill in sa and return an unconnected socket. */
+	char path[PATH_MAX];
+	sockpath(path);
+	memset(sa, 0, sizeof(struct sockaddr_un));
+	sa->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(sa->sun_path)) {
+		fprintf(stderr, "Socket path too long: %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+	strcpy(sa->sun_path, path);
+	int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (sock == -1) {
+		perror("socket");
+		exit(EXIT_FAILURE);
+	}
+	return sock;
+} // opensocket()
+
+void
+handle(int conn, request_f run)
+{ /* Read one request and run it in this process, which the daemon
+   * forked for it. sendreply() answers with its status and how long it
+   * took however it exits. Does not return.
+  */
+	static reply_t r;
+	clock_gettime(CLOCK_MONOTONIC, &r.t0);
+	r.conn = conn;
+	char *buf = xmalloc(MAXREQ);
+	int fds[NFDS];
+	ssize_t len = getrequest(conn, buf, MAXREQ, fds);
+	if (len <= 0) exit(EXIT_FAILURE);	// includes connect() and close.
+	// argc, the arguments, then the caller's environment.
+	int n = 0;
+	ssize_t i;
+	for (i = 0; i < len; i++) {
+		if (buf[i] == 0) n++;
+	}
+	char **strs = xmalloc((n + 1) * sizeof(char *));
+	char *cp = buf;
+	for (i = 0; i < n; i++) {
+		strs[i] = cp;
+		cp += strlen(cp) + 1;
+	}
+	strs[n] = NULL;
+	r.argc = atoi(strs[0]);
+	if (r.argc < 1 || r.argc >= n) {
+		fputs("Malformed request.\n", stderr);
+		exit(EXIT_FAILURE);
+	}
+	r.argv = xmalloc((r.argc + 1) * sizeof(char *));
+	memcpy(r.argv, strs + 1, r.argc * sizeof(char *));
+	r.argv[r.argc] = NULL;
+	char **env;
+	clearenv();	// HOME, TMPDIR, CC and the like are the caller's.
+	for (env = strs + 1 + r.argc; *env; env++) putenv(*env);
+	fflush(NULL);
+	r.logfd = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, 3);
+	for (i = 0; i < 3; i++) {
+		dup2(fds[i], i);
+	}
+	if (fchdir(fds[3]) == -1) {
+		perror("fchdir");
+		exit(EXIT_FAILURE);
+	}
+	for (i = 0; i < NFDS; i++) close(fds[i]);
+	on_exit(sendreply, &r);
+	optind = 0;	// getopt starts afresh.
+	options_t opt = process_options(r.argc, r.argv);
+	exit(run(&opt, r.argv));
+} // handle()
+
+void
+sendreply(int status, void *arg)
+{ /* on_exit() handler, reply to the client and log the request on the
+   * daemon's stderr.
+  */
+	reply_t *r = arg;
+	fflush(NULL);	// what the request wrote goes before its status.
+	double ms = msecs(&r->t0);
+	char reply[128];
+	int rl = snprintf(reply, sizeof(reply), "status %d time %.3f ms\n",
+						status, ms);
+	send(r->conn, reply, rl, MSG_NOSIGNAL);
+	if (r->logfd == -1) return;
+	dprintf(r->logfd, "%s:", r->argv[0]);
+	int i;
+	for (i = 1; i < r->argc; i++) dprintf(r->logfd, " %s", r->argv[i]);
+	dprintf(r->logfd, ": %s", reply);
+} // sendreply()
+
+ssize_t
+getrequest(int conn, char *buf, size_t size, int *fds)
+{ /* Receive the request into buf and its descriptors into fds. Returns
+   * the length of the request, 0 if the peer just closed, -1 if the
+   * request is malformed.
+  */
+	union {
+		char buf[CMSG_SPACE(NFDS * sizeof(int))];
+		struct cmsghdr align;
+	} ctl;
+	struct iovec iov = { buf, size };
+	struct msghdr msg = {0};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = ctl.buf;
+	msg.msg_controllen = sizeof(ctl.buf);
+	ssize_t len;
+	do {
+		len = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+	} while (len == -1 && errno == EINTR);
+	if (len == -1) {
+		perror("recvmsg");
+		return -1;
+	}
+	if (len == 0) return 0;	// only checking for a daemon.
+	struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+	if (!cm || cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS
+			|| cm->cmsg_len != CMSG_LEN(NFDS * sizeof(int))
+			|| (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))
+			|| buf[len - 1] != 0) {
+		fputs("Malformed request.\n", stderr);
+		return -1;
+	}
+	memcpy(fds, CMSG_DATA(cm), NFDS * sizeof(int));
+	return len;
+} // getrequest()
+
+double
+msecs(const struct timespec *t0)
+{ /* Milliseconds since t0. */
+	struct timespec t1;
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return (t1.tv_sec - t0->tv_sec) * 1e3
+			+ (t1.tv_nsec - t0->tv_nsec) / 1e6;
+} // msecs()
@@ -0,0 +1,47 @@
+/*    daemon.h
+ *
+ * Copyright 2017 Robert L (Bob) Parker rlp1938@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+/* The purpose of daemon.[h|c] is to let newprogram stay resident with
+ * its stubs, config and component locations loaded, taking requests
+ * over a unix socket, $XDG_RUNTIME_DIR/newprogram.sock or, without
+ * XDG_RUNTIME_DIR, $HOME/.cache/newprogram/sock.
+ *
+ * A request is one SOCK_SEQPACKET message holding the argument count,
+ * the command line arguments and the caller's environment, each '\0'
+ * terminated, with the caller's stdin, stdout, stderr and working
+ * directory passed as SCM_RIGHTS descriptors. The reply is one message,
+ * "status <exit status> time <msecs> ms\n".
+ * */
+#ifndef _DAEMON_H
+#define _DAEMON_H
+#include "str.h"
+#include "files.h"
+#include "dirs.h"
+#include "gopt.h"
+
+typedef int (*request_f)(options_t *, char **);
+
+void
+rundaemon(request_f run);
+
+int
+runclient(int argc, char **argv, double *ms);
+
+#endif
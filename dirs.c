@@ -23,8 +23,19 @@
  * files.[h|c].
  * */
 
+#include <fnmatch.h>
 #include "dirs.h"
 
+static size_t packdir(char *path, uint32_t parent, rd_tree *t,
+						rd_data *rd);
+static size_t addrec(rd_tree *t, uint32_t parent, struct dirent *de);
+static void *growby2(void *p, size_t *cap, size_t need, size_t size);
+static int rejected(const rd_data *rd, const char *path,
+					const char *name);
+static size_t pathhash(const char *path);
+static void hashrejects(rd_data *rd);
+static void compileglob(rd_glob *g, const char *pat);
+
 DIR
 *dopendir(const char *name)
 { /* open a dir with error handling */
@@ -42,7 +53,7 @@ recursedir(char *dirname, mdata *ddat, rd_data *rd)
 	* Caller must init_recursedir() before calling this.
 	*/
 	DIR *dp = dopendir(dirname);
-	static int recs = 0;
+	int recs = 0;
 	struct dirent *de;
 	while ((de = readdir(dp))) {
 		if (strcmp(de->d_name, ".") == 0 ) continue;
@@ -52,8 +63,8 @@ recursedir(char *dirname, mdata *ddat, rd_data *rd)
 		strjoin(joinbuf, '/', de->d_name, PATH_MAX);
 		/* If there is list of paths to reject check that any dirs
 		 * found are not in rd->rejectlist[] */
-		if ((rd->rejectlist) && de->d_type == DT_DIR) {
-			if(instrlist(joinbuf, rd->rejectlist)) continue;
+		if (de->d_type == DT_DIR && rejected(rd, joinbuf, de->d_name)) {
+			continue;
 		}
 		// Output only file system objects named in rd->fsobj[]
 		if (in_uch_array(de->d_type, rd->fsobj)) {
@@ -61,20 +72,165 @@ recursedir(char *dirname, mdata *ddat, rd_data *rd)
 			recs++;
 		}
 		if (de->d_type == DT_DIR) {
-			recursedir(joinbuf, ddat, rd);
+			recs += recursedir(joinbuf, ddat, rd);
 		}
 	} // while()
 	doclosedir(dp);
 	return recs;
 } // recursedir()
 
+/* recursetree() is recursedir() for big trees. Rather than a full path
+ * string for each object it keeps a 16 byte record with the index of
+ * its dir's record, so each name is stored once however deep it is,
+ * along with d_type and d_ino so that they need not be stat()'d again.
+ * Dirs are always recorded whatever rd->fsobj says, the records under
+ * them need them, use rdt_type() to pass them over. Storage doubles as
+ * needed, rd->meminc is not used.
+ * */
+
+rd_tree
+*init_rdtree(const char *dirname)
+{ /* An empty tree for recursetree() to fill from dirname. */
+	rd_tree *t = xmalloc(sizeof(rd_tree));
+	memset(t, 0, sizeof(rd_tree));
+	t->root = xstrdup((char *)dirname);
+	return t;
+} // init_rdtree()
+
+size_t
+recursetree(rd_tree *t, rd_data *rd)
+{ /* Walk t->root as recursedir() would, adding to t. Returns the number
+   * of records added.
+  */
+	char path[PATH_MAX];
+	strcpy(path, t->root);
+	size_t recs = packdir(path, RD_ROOT, t, rd);
+	// done growing, give back what doubling left unused.
+	if (t->n) {
+		t->rec = realloc(t->rec, t->n * sizeof(rd_rec));
+		t->names = realloc(t->names, t->nlen);
+		t->cap = t->n;
+		t->ncap = t->nlen;
+	}
+	return recs;
+} // recursetree()
+
+size_t
+packdir(char *path, uint32_t parent, rd_tree *t, rd_data *rd)
+{ /* Record what is in path, which is a PATH_MAX buffer that each
+   * level adds its name to and takes it off again.
+  */
+	DIR *dp = dopendir(path);
+	size_t plen = strlen(path);
+	size_t recs = 0;
+	struct dirent *de;
+	while ((de = readdir(dp))) {
+		if (strcmp(de->d_name, ".") == 0 ) continue;
+		if (strcmp(de->d_name, "..") == 0) continue;
+		int isdir = (de->d_type == DT_DIR);
+		if (!isdir && !in_uch_array(de->d_type, rd->fsobj)) continue;
+		path[plen] = 0;
+		strjoin(path, '/', de->d_name, PATH_MAX);
+		if (isdir && rejected(rd, path, de->d_name)) continue;
+		size_t idx = addrec(t, parent, de);
+		recs++;
+		if (isdir) recs += packdir(path, idx, t, rd);
+	} // while()
+	path[plen] = 0;
+	doclosedir(dp);
+	return recs;
+} // packdir()
+
+size_t
+addrec(rd_tree *t, uint32_t parent, struct dirent *de)
+{ /* Append the record for de, returning its index. */
+	size_t len = strlen(de->d_name);
+	if (t->n >= RD_ROOT || t->nlen + len + 2 > UINT32_MAX) {
+		fputs("Too many objects for recursetree().\n", stderr);
+		exit(EXIT_FAILURE);
+	}
+	t->rec = growby2(t->rec, &t->cap, t->n + 1, sizeof(rd_rec));
+	t->names = growby2(t->names, &t->ncap, t->nlen + len + 2, 1);
+	t->names[t->nlen++] = de->d_type;
+	rd_rec *r = &t->rec[t->n];
+	r->ino = de->d_ino;
+	r->parent = parent;
+	r->name = t->nlen;
+	memcpy(t->names + t->nlen, de->d_name, len + 1);
+	t->nlen += len + 1;
+	return t->n++;
+} // addrec()
+
+void
+*growby2(void *p, size_t *cap, size_t need, size_t size)
+{ /* realloc() p to hold at least need items of size, doubling *cap. */
+	if (need <= *cap) return p;
+	size_t nc = (*cap) ? *cap : 1024;
+	while (nc < need) nc *= 2;
+	p = realloc(p, nc * size);
+	if (!p) {
+		fputs("Out of memory.\n", stderr);
+		exit(EXIT_FAILURE);
+	}
+	*cap = nc;
+	return p;
+} // growby2()
+
+const char
+*rdt_name(const rd_tree *t, size_t i)
+{ /* The name of record i, without its dir. */
+	return t->names + t->rec[i].name;
+} // rdt_name()
+
+unsigned char
+rdt_type(const rd_tree *t, size_t i)
+{ /* The d_type of record i. */
+	return t->names[t->rec[i].name - 1];
+} // rdt_type()
+
+char
+*rdt_path(const rd_tree *t, size_t i, char *buf, size_t size)
+{ /* The full path of record i into buf, as recursedir() would have
+   * recorded it, built back from the name up through its dirs. NULL
+   * with errno ENAMETOOLONG if it won't fit in size.
+  */
+	size_t pos = size;
+	uint32_t j;
+	for (j = i; ; j = t->rec[j].parent) {
+		const char *name = (j == RD_ROOT) ? t->root : rdt_name(t, j);
+		size_t len = strlen(name) + 1;	// a '/' or the final '\0'.
+		if (len > pos) {
+			errno = ENAMETOOLONG;
+			return NULL;
+		}
+		pos -= len;
+		memcpy(buf + pos, name, len - 1);
+		buf[pos + len - 1] = (pos + len == size) ? 0 : '/';
+		if (j == RD_ROOT) break;
+	}
+	memmove(buf, buf + pos, size - pos);
+	return buf;
+} // rdt_path()
+
+void
+free_rdtree(rd_tree *t)
+{
+	free(t->rec);	// NULL if nothing was found, which vfree() won't do.
+	free(t->names);
+	vfree(t->root, t, NULL);
+} // free_rdtree()
+
 /*
  * For fsobj below use DT_BLK, DT_CHR, DT_DIR, DT_FIFO, DT_LNK, DT_REG,
  * DT_SOCK, DT_UNKNOWN as required.
  * Most needs will be met by DT_DIR and DT_REG.
  * DT_DIR will always be needed else the recursion can never happen.
  * Excludes may be NULL and if it is there will be no dirs excluded from
- * the output.
+ * the output. An exclude with any of "*?[" in it is a pattern, matched
+ * against the dir's name if it has no '/', eg "build*", and else
+ * against its whole path, eg "*\/.git". Otherwise it is a path, to be
+ * found by realpath() and hashed, so that any number of them cost one
+ * lookup per dir.
  * */
 
 rd_data
@@ -90,11 +246,17 @@ rd_data
 		n = i + 1;
 		rd->rejectlist = xmalloc(n * sizeof(char *));
 		memset(rd->rejectlist, 0, n * sizeof(char *));
-		for (i = 0, j = 0; i < n; i++) {
+		rd->globs = xmalloc(n * sizeof(rd_glob));
+		for (i = 0, j = 0; i < n - 1; i++) {
+			if (strpbrk(excludes[i], "*?[")) {
+				compileglob(&rd->globs[rd->nglobs++], excludes[i]);
+				continue;
+			}
 			// deal with non-existence of realpath() some names.
 			char *cp = realpath(excludes[i], NULL);
 			if (cp) rd->rejectlist[j++] = cp;
 		} // for()
+		hashrejects(rd);
 	} // if()
 	int i = 0;
 	va_list ap;
@@ -114,15 +276,101 @@ void
 free_recursedir(rd_data *rd, mdata *md)
 { /* free resources allocated by init_recursedir() */
 	if (rd->rejectlist) {
-		int i;
+		size_t i;
 		for (i = 0; rd->rejectlist[i]; i++) free(rd->rejectlist[i]);
 		free(rd->rejectlist);
+		for (i = 0; i < rd->nglobs; i++) free(rd->globs[i].pat);
+		free(rd->globs);
+		free(rd->rejectset);	// holds the same strings as rejectlist.
 	}
 	free(rd);
 	free(md->fro);
 	free(md);
 } // free_recursedir()
 
+void
+hashrejects(rd_data *rd)
+{ /* Put rd->rejectlist into an open addressed set at most half full. */
+	size_t n, size = 16;
+	for (n = 0; rd->rejectlist[n]; n++);
+	while (size < 2 * n) size *= 2;
+	rd->rejectset = xmalloc(size * sizeof(char *));
+	memset(rd->rejectset, 0, size * sizeof(char *));
+	rd->setmask = size - 1;
+	size_t i;
+	for (i = 0; i < n; i++) {
+		size_t h = pathhash(rd->rejectlist[i]) & rd->setmask;
+		while (rd->rejectset[h]) h = (h + 1) & rd->setmask;
+		rd->rejectset[h] = rd->rejectlist[i];
+	}
+} // hashrejects()
+
+size_t
+pathhash(const char *path)
+{ /* FNV-1a */
+	uint64_t h = 14695981039346656037ULL;
+	for ( ; *path; path++) {
+		h ^= (unsigned char)*path;
+		h *= 1099511628211ULL;
+	}
+	return h;
+} // pathhash()
+
+void
+compileglob(rd_glob *g, const char *pat)
+{ /* Most patterns are "name*" or "*name", which need no fnmatch(). */
+	g->pat = xstrdup((char *)pat);
+	g->onname = (strchr(pat, '/') == NULL);
+	size_t len = strlen(pat);
+	size_t nstar = 0;
+	const char *cp;
+	for (cp = pat; *cp; cp++) if (*cp == '*') nstar++;
+	int other = (strpbrk(pat, "?[\\") != NULL);
+	if (!other && nstar == 1 && pat[len - 1] == '*') {
+		g->kind = RG_PREFIX;
+		g->litlen = len - 1;
+	} else if (!other && nstar == 1 && pat[0] == '*') {
+		g->kind = RG_SUFFIX;
+		g->litlen = len - 1;
+	} else {
+		g->kind = RG_FNMATCH;
+		g->litlen = 0;
+	}
+} // compileglob()
+
+int
+rejected(const rd_data *rd, const char *path, const char *name)
+{ /* 1 if the dir at path, called name, is one of rd's excludes. */
+	if (!rd->rejectlist) return 0;
+	size_t h = pathhash(path) & rd->setmask;
+	while (rd->rejectset[h]) {
+		if (strcmp(rd->rejectset[h], path) == 0) return 1;
+		h = (h + 1) & rd->setmask;
+	}
+	size_t i;
+	for (i = 0; i < rd->nglobs; i++) {
+		const rd_glob *g = &rd->globs[i];
+		const char *s = (g->onname) ? name : path;
+		size_t slen;
+		switch (g->kind) {
+		case RG_PREFIX:
+			if (strncmp(s, g->pat, g->litlen) == 0) return 1;
+			break;
+		case RG_SUFFIX:
+			slen = strlen(s);
+			if (slen >= g->litlen &&
+				memcmp(s + slen - g->litlen, g->pat + 1, g->litlen) == 0) {
+				return 1;
+			}
+			break;
+		default:
+			if (fnmatch(g->pat, s, 0) == 0) return 1;
+			break;
+		}
+	}
+	return 0;
+} // rejected()
+
 void
 doclosedir(DIR *dp)
 {	/* closedir() with error handling */
@@ -140,6 +388,7 @@ newdir(const char *p, int mayexist)
 		if(exists_dir(p)) return;
 	}
 	const int crmode = 0775;	// stat yielded this value.
+	forgetstat(AT_FDCWD, p);
 	if (mkdir(p, crmode) == -1) {
 		perror(p);
 		exit(EXIT_FAILURE);
@@ -158,17 +407,43 @@ xchdir(const char *path)
 int
 exists_dir(const char *path)
 { /* return 1 if the dir exists, 0 otherwise */
-	struct stat sb;
-	int res = stat(path, &sb);
-	if (res == -1) {
-		res = 0;
-	} else {
-		res = 1;
+	struct statx st;
+	if (cachedstat(path, STATX_TYPE, &st) == -1) return 0;
+	return S_ISDIR(st.stx_mode) != 0;
+} // exists_dir()
+
+int
+opendirfd(int dirfd, const char *path)
+{ /* An fd for the dir at path, relative to dirfd, to give to the *at()
+   * functions. Close it when done.
+  */
+	int fd = openat(dirfd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd == -1) {
+		perror(path);
+		exit(EXIT_FAILURE);
 	}
-	if (res && S_ISDIR(sb.st_mode)) {
-		res = 1;
-	} else {
-		res = 0;
+	return fd;
+} // opendirfd()
+
+void
+newdirat(int dirfd, const char *p, int mayexist)
+{ /* As newdir() for p relative to dirfd. */
+	if (mayexist) {
+		if(exists_dirat(dirfd, p)) return;
 	}
-	return res;
-} // exists_dir()
+	const int crmode = 0775;	// stat yielded this value.
+	forgetstat(dirfd, p);
+	if (mkdirat(dirfd, p, crmode) == -1) {
+		perror(p);
+		exit(EXIT_FAILURE);
+	}
+} // newdirat()
+
+int
+exists_dirat(int dirfd, const char *path)
+{ /* As exists_dir() for path relative to dirfd. */
+	struct stat sb;
+	if (fstatat(dirfd, path, &sb, 0) == -1) return 0;
+	return S_ISDIR(sb.st_mode) != 0;
+} // exists_dirat()
+
@@ -41,15 +41,48 @@
 #include <linux/limits.h>
 #include <libgen.h>
 #include <errno.h>
+#include <stdint.h>
 #include "str.h"
 #include "files.h"
 
+typedef struct rd_glob {	/* an exclude with wildcards, compiled */
+	char *pat;			// as given.
+	size_t litlen;		// length of the literal part of RG_PREFIX and
+						// RG_SUFFIX patterns.
+	int kind;			// RG_FNMATCH ones go to fnmatch().
+	int onname;			// no '/' in it, so match the name not the path.
+} rd_glob;
+
+enum { RG_PREFIX, RG_SUFFIX, RG_FNMATCH };
+
 typedef struct rd_data {
 	char **rejectlist;
 	size_t meminc;
 	unsigned char fsobj[9];
+	char **rejectset;	// rejectlist hashed, see rejected().
+	size_t setmask;
+	rd_glob *globs;
+	size_t nglobs;
 } rd_data;
 
+#define RD_ROOT UINT32_MAX	// parent of the records in the top dir.
+
+typedef struct rd_rec {	/* one object found by recursetree() */
+	uint64_t ino;		// d_ino.
+	uint32_t parent;	// index of the record of its dir, or RD_ROOT.
+	uint32_t name;		// offset of its name in rd_tree.names.
+} rd_rec;
+
+typedef struct rd_tree {	/* what recursetree() found, see rdt_*() */
+	char *root;			// the dir that was walked.
+	rd_rec *rec;
+	size_t n;
+	size_t cap;
+	char *names;		// each name has its d_type in the byte before.
+	size_t nlen;
+	size_t ncap;
+} rd_tree;
+
 rd_data
 *init_recursedir(char **excludes, size_t meminc,/*d_type*/ ...);
 /* vargs are list of d_type, must terminate with 0 */
@@ -66,6 +99,24 @@ doclosedir(DIR *dp);
 int
 recursedir(char *dirname, mdata *ddat, rd_data *rd);
 
+rd_tree
+*init_rdtree(const char *dirname);
+
+size_t
+recursetree(rd_tree *t, rd_data *rd);
+
+const char
+*rdt_name(const rd_tree *t, size_t i);
+
+unsigned char
+rdt_type(const rd_tree *t, size_t i);
+
+char
+*rdt_path(const rd_tree *t, size_t i, char *buf, size_t size);
+
+void
+free_rdtree(rd_tree *t);
+
 void
 newdir(const char *dname, int mayexist);
 
@@ -75,4 +126,13 @@ xchdir(const char *);
 int
 exists_dir(const char *);
 
+int
+opendirfd(int dirfd, const char *path);
+
+void
+newdirat(int dirfd, const char *dname, int mayexist);
+
+int
+exists_dirat(int dirfd, const char *path);
+
 #endif
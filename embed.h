@@ -0,0 +1,40 @@
+/*    embed.h
+ *
+ * Copyright 2017 Robert L (Bob) Parker rlp1938@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+/* embed.c is written at build time by mkembed.sh, it holds the default
+ * stubs and config file so that newprogram needs no installed data.
+ * */
+#ifndef _EMBED_H
+#define _EMBED_H
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct embed_t {
+	const char *name;	// file name of the stub.
+	const char *data;	// its content, '\0' terminated.
+	size_t len;			// not counting the '\0'.
+	const unsigned *marks;	// where placeholders may be, see stubs.c.
+	size_t nmarks;
+} embed_t;
+
+extern const embed_t embedded[];	// NULL name terminated.
+extern const uint64_t embedsum;		// differs for other stubs.
+
+#endif
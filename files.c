@@ -25,6 +25,30 @@
 
 #include "files.h"
 
+/* The stat cache. A run asks after the same paths again and again, so
+ * exists_file(), exists_dir() and getfsize() go through cachedstat(),
+ * which statx()'s a path only for the fields not already held for it.
+ * Failures are kept too, a missing file stays missing. Entries are
+ * keyed by the path string as given and each thread has a cache of its
+ * own, so there is no locking. Everything here that changes a path
+ * forgets it, anything else that does, another process say, should be
+ * followed by forgetstat() or clearstats().
+ * */
+typedef struct statent {
+	char *path;			// NULL for an empty slot.
+	size_t hash;
+	int err;			// errno from statx(), 0 if it worked.
+	struct statx st;	// st.stx_mask says which fields are good.
+} statent;
+
+static __thread statent *stab;
+static __thread size_t stabsize;	// a power of 2.
+static __thread size_t stabused;
+
+static size_t statslot(const char *path, size_t hash);
+static size_t strhash(const char *s);
+static void growstats(void);
+
 void
 writestrarray(char **list)
 { /* output the strings to console - must be NULL terminated. */
@@ -36,16 +60,26 @@ writestrarray(char **list)
 char
 **getfile_str(const char *path)
 { /* Read file at path. File to have lines terminated with '\n'.
-   * Returns list of C strings with NULL terminated list.
+   * Returns list of C strings with NULL terminated list. The strings
+   * share one block, free(list[0]) then free(list) to be rid of them.
 */
-	mdata *md = readfile(path, 1, 0);
-	int n = memlinestostr(md);
-	if (!n)
+	mdata *md = readfile(path, 1, 1);	// the 1 ends an unended line.
+	lineidx_t *li = mklineidx(md->fro, md->to);
+	if (!li->n)
 	{
-		fprintf(stderr, "File %s contains no line delimeters,\n", path);
+		fprintf(stderr, "File %s contains no lines,\n", path);
 		exit(EXIT_FAILURE);
 	}
-	return memblocktoarray(md, n);
+	char **res = xmalloc((li->n + 1) * sizeof(char *));
+	size_t i;
+	for (i = 0; i < li->n; i++) {
+		res[i] = md->fro + li->line[i].off;
+		res[i][li->line[i].len] = 0;
+	}
+	res[li->n] = NULL;
+	freelineidx(li);
+	free(md);	// the block lives on as res[0].
+	return res;
 } // getfile_str()
 
 time_t
@@ -67,6 +101,7 @@ xsystem(const char *cmd, int fatal)
    * the caller.
 */
 	const int status = system(cmd);
+	clearstats();	// cmd may have changed anything.
 	if (status == -1) {	// this always fatal
 		fprintf(stderr, "system failed to execute: %s\n", cmd);
 		exit(EXIT_FAILURE);
@@ -86,13 +121,21 @@ xsystem(const char *cmd, int fatal)
 void
 dumpstrblock(const char *tmpfn, mdata *md)
 { /* Dumps the block of C strings named by md to the file named by
-   * tmpfn. The block will be altered to a block of lines terminated by
-   * '\n', then written to tmpfn and restored to C strings before
-   * returning. Tmpfn may be "-" to write to stdout.
+   * tmpfn, each '\0' written as '\n'. The block is not altered, the
+   * strings and newlines go out in one writev(). Tmpfn may be "-" to
+   * write to stdout.
 */
-	memstrtolines(md);
-	writefile(tmpfn, md->fro, md->to, "w");
-	memlinestostr(md);
+	iolist_t il = {0};
+	char *cp = md->fro;
+	while (cp < md->to) {
+		char *end = memchr(cp, 0, md->to - cp);
+		if (!end) end = md->to;
+		ioladd(&il, cp, end - cp);
+		if (end < md->to) ioladd(&il, "\n", 1);
+		cp = end + 1;
+	}
+	writefileiov(tmpfn, &il, "w");
+	freeiol(&il);
 } // dumpstrblock()
 
 ino_t
@@ -109,6 +152,7 @@ getinode(const char *path)
 void
 touch(const char *fn)
 {/* Emulates the simplest use of the shell touch command. */
+	forgetstat(AT_FDCWD, fn);
 	FILE *fp = dofopen(fn, "a");	// avoid zeroing an existing file.
 	dofclose(fp);
 } // touch()
@@ -127,11 +171,9 @@ str2file(const char *fn, const char *s, const char *mode)
 		exit(EXIT_FAILURE);
 	}
 	size_t len = strlen(s);
-	char *buf = xmalloc(len + 1);
-	strcpy(buf, s);
-	buf[len] = '\n';
-	writefile(fn, buf, buf+len+1, mode);
-	free(buf);
+	struct iovec iov[2] = {{(void *)s, len}, {"\n", 1}};
+	iolist_t il = {iov, 2, 2, len + 1};
+	writefileiov(fn, &il, mode);
 } // str2file()
 
 FILE
@@ -173,7 +215,10 @@ writefile(const char *filename, char *fro, char *to, const char *fmode)
 		fpo = stdout;
 		closeit = 0;
 	}
-	else fpo = dofopen(filename, fmode);
+	else {
+		forgetstat(AT_FDCWD, filename);
+		fpo = dofopen(filename, fmode);
+	}
 	size_t written = fwrite(fro, 1, (size_t)len, fpo);
 	if (written != (size_t)len) {
 		perror("writefile");
@@ -191,65 +236,30 @@ mdata
 {	/* If fatal is 0 will not terminate with error if path does not
 	 * exist, but will return NULL instead. All other errors are always
 	 * fatal. If extra is non-zero will provide extra space, init to 0.
+	 * The size comes from fstat() on the open file, not from the stat
+	 * cache, so it is always that of what is read.
 	*/
-	mdata *ret = NULL;
-	if (exists_file(path)) {
-		ret = malloc(sizeof(mdata));
-		if (!ret) {
-			fputs("Out of memory.\n", stderr);
-			exit(EXIT_FAILURE);
-		}
-		size_t fsize = getfsize(path);
-		size_t blocksize = fsize + extra;
-		ret->fro = malloc(blocksize);
-		memset(ret->fro, 0, blocksize);
-		FILE *fp = dofopen(path, "r");
-		size_t bread = fread(ret->fro, 1, fsize, fp);
-		dofclose(fp);
-		if (bread != fsize) {
-			fprintf(stderr,
-			"Expected to get %lu bytes, but got %lu bytes.\n",
-			fsize, bread);
-			exit(EXIT_FAILURE);
-		}
-		ret->to = ret->fro + fsize;
-		ret->limit = ret->fro + blocksize;
-	} else if (fatal) {
-		perror(path);
-		exit(EXIT_FAILURE);
-	}
-	return ret;
+	return readfileat(AT_FDCWD, path, fatal, extra);
 } //readfile()
 
 int
 exists_file(const char *path)
 {	/* returns 1 if I can stat the object and it's a regular file,
 	*  0 otherwise */
-	struct stat sb;
-	int res = stat(path, &sb);
-	if (res == -1) {
-		res = 0;
-	} else {
-		res = 1;
-	}
-	if (res && S_ISREG(sb.st_mode)) {
-		res = 1;
-	} else {
-		res = 0;
-	}
-	return res;
+	struct statx st;
+	if (cachedstat(path, STATX_TYPE, &st) == -1) return 0;
+	return S_ISREG(st.stx_mode) != 0;
 } // exists_file()
 
 off_t
 getfsize(const char *path)
 {	/* returns file size if path exists, fatal otherwise */
-	struct stat sb;
-	int res = stat(path, &sb);
-	if (res == -1) {
+	struct statx st;
+	if (cachedstat(path, STATX_SIZE, &st) == -1) {
 		perror(path);
 		exit(EXIT_FAILURE);
 	}
-	return sb.st_size;
+	return st.stx_size;
 } // getfsize()
 
 mdata
@@ -272,6 +282,7 @@ copyfile(const char *pathfro, const char *pathto)
 void
 dolink(const char *fr, const char *to)
 {/* link() with error handling. */
+	forgetstat(AT_FDCWD, to);
 	if (link(fr, to) == -1) {
 		perror(to);
 		perror(fr);	// don't know what caused the snafu
@@ -306,9 +317,303 @@ char
 void
 dounlink(const char *p)
 {/* unlink with error handling. */
+	forgetstat(AT_FDCWD, p);
 	int res = unlink(p);
 	if (res == -1) {
 		perror(p);
 		exit(EXIT_FAILURE);
 	}
 } // dounlink()
+
+mdata
+*readfileat(int dirfd, const char *path, int fatal, size_t extra)
+{	/* As readfile() for path relative to dirfd. */
+	int fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		if (errno == ENOENT && !fatal) return NULL;
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+	struct stat sb;
+	if (fstat(fd, &sb) == -1) {
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+	if (!S_ISREG(sb.st_mode)) {	// a dir, say, is not a file to read.
+		close(fd);
+		if (!fatal) return NULL;
+		fprintf(stderr, "%s: not a regular file.\n", path);
+		exit(EXIT_FAILURE);
+	}
+	size_t fsize = sb.st_size;
+	mdata *ret = init_mdata();
+	ret->fro = xmalloc(fsize + extra + 1);
+	memset(ret->fro + fsize, 0, extra + 1);
+	size_t done = 0;
+	while (done < fsize) {
+		ssize_t got = read(fd, ret->fro + done, fsize - done);
+		if (got == -1 && errno == EINTR) continue;
+		if (got <= 0) {
+			fprintf(stderr,
+			"Expected to get %lu bytes, but got %lu bytes.\n",
+			fsize, done);
+			exit(EXIT_FAILURE);
+		}
+		done += got;
+	}
+	close(fd);
+	ret->to = ret->fro + fsize;
+	ret->limit = ret->to + extra;
+	return ret;
+} // readfileat()
+
+void
+writefileat(int dirfd, const char *path, const char *fro, const char *to,
+			const char *fmode)
+{	/* As writefile() for path relative to dirfd, except that "-" is not
+	 * stdout.
+	*/
+	int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+	flags |= (fmode[0] == 'a') ? O_APPEND : O_TRUNC;
+	forgetstat(dirfd, path);
+	int fd = openat(dirfd, path, flags, 0666);
+	if (fd == -1) {
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+	while (fro < to) {
+		ssize_t done = write(fd, fro, to - fro);
+		if (done == -1 && errno == EINTR) continue;
+		if (done == -1) {
+			perror(path);
+			exit(EXIT_FAILURE);
+		}
+		fro += done;
+	}
+	if (close(fd) == -1) {
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+} // writefileat()
+
+int
+exists_fileat(int dirfd, const char *path)
+{	/* As exists_file() for path relative to dirfd. */
+	struct stat sb;
+	if (fstatat(dirfd, path, &sb, 0) == -1) return 0;
+	return S_ISREG(sb.st_mode) != 0;
+} // exists_fileat()
+
+void
+dolinkat(int frofd, const char *fr, int tofd, const char *to)
+{/* linkat() with error handling. */
+	forgetstat(tofd, to);
+	if (linkat(frofd, fr, tofd, to, 0) == -1) {
+		perror(to);
+		perror(fr);	// don't know what caused the snafu
+		exit(EXIT_FAILURE);
+	}
+} // dolinkat()
+
+void
+dounlinkat(int dirfd, const char *p, int flags)
+{/* unlinkat() with error handling, flags may be AT_REMOVEDIR. */
+	forgetstat(dirfd, p);
+	if (unlinkat(dirfd, p, flags) == -1) {
+		perror(p);
+		exit(EXIT_FAILURE);
+	}
+} // dounlinkat()
+
+int
+writeiov(int fd, const iolist_t *il)
+{ /* Write all the pieces of il to fd with as few writev() calls as
+   * IOV_MAX allows, carrying on after short writes. Returns 0, or -1
+   * with errno set.
+  */
+	size_t i = 0;
+	size_t off = 0;			// already written from il->iov[i].
+	struct iovec iov[IOV_MAX];
+	while (i < il->n) {
+		int n = 0;
+		size_t j;
+		for (j = i; j < il->n && n < IOV_MAX; j++, n++) {
+			iov[n] = il->iov[j];
+		}
+		iov[0].iov_base = (char *)iov[0].iov_base + off;
+		iov[0].iov_len -= off;
+		ssize_t done = writev(fd, iov, n);
+		if (done == -1) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		size_t left = done;
+		while (i < il->n && left >= il->iov[i].iov_len - off) {
+			left -= il->iov[i].iov_len - off;
+			off = 0;
+			i++;
+		}
+		off += left;
+	}
+	return 0;
+} // writeiov()
+
+void
+writefileiov(const char *fn, const iolist_t *il, const char *fmode)
+{ /* As writefile() for the pieces of il. */
+	if (!il->len) return;
+	int fd = STDOUT_FILENO;
+	if (strcmp("-", fn) == 0) {
+		fflush(stdout);	// keep order with what stdio holds.
+	} else {
+		int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+		flags |= (fmode[0] == 'a') ? O_APPEND : O_TRUNC;
+		forgetstat(AT_FDCWD, fn);
+		fd = open(fn, flags, 0666);
+		if (fd == -1) {
+			perror(fn);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (writeiov(fd, il) == -1) {
+		perror(fn);
+		exit(EXIT_FAILURE);
+	}
+	if (fd != STDOUT_FILENO && close(fd) == -1) {
+		perror(fn);
+		exit(EXIT_FAILURE);
+	}
+} // writefileiov()
+
+int
+cachedstat(const char *path, unsigned mask, struct statx *st)
+{ /* statx() path for at least the STATX_* fields in mask, unless the
+   * cache has them already. Returns 0, or -1 with errno set as statx()
+   * left it the first time.
+  */
+	if (!stab) growstats();
+	size_t hash = strhash(path);
+	size_t i = statslot(path, hash);
+	statent *se = &stab[i];
+	if (se->path && (se->err || (se->st.stx_mask & mask) == mask)) {
+		if (se->err) {
+			errno = se->err;
+			return -1;
+		}
+		*st = se->st;
+		return 0;
+	}
+	if (se->path) mask |= se->st.stx_mask;	// keep what it had.
+	struct statx got;
+	int err = 0;
+	if (statx(AT_FDCWD, path, 0, mask, &got) == -1) err = errno;
+	if (!se->path) {
+		if (2 * (stabused + 1) > stabsize) {
+			growstats();
+			i = statslot(path, hash);
+			se = &stab[i];
+		}
+		se->path = xstrdup((char *)path);
+		se->hash = hash;
+		stabused++;
+	}
+	se->err = err;
+	if (!err) se->st = got;
+	if (err) {
+		errno = err;
+		return -1;
+	}
+	*st = got;
+	return 0;
+} // cachedstat()
+
+void
+prefetchstats(char **paths, unsigned mask)
+{ /* cachedstat() each of the NULL terminated paths, for a caller about
+   * to ask after them all.
+  */
+	struct statx st;
+	for ( ; *paths; paths++) cachedstat(*paths, mask, &st);
+} // prefetchstats()
+
+void
+forgetstat(int dirfd, const char *path)
+{ /* Drop what is cached for path, relative to dirfd. A path relative to
+   * some other dir could be any entry, so that clears the lot.
+  */
+	if (!stab) return;
+	if (dirfd != AT_FDCWD && path[0] != '/') {
+		clearstats();
+		return;
+	}
+	size_t i = statslot(path, strhash(path));
+	if (!stab[i].path) return;
+	free(stab[i].path);
+	stab[i].path = NULL;
+	stabused--;
+	// close the gap so that later entries can still be found.
+	size_t mask = stabsize - 1;
+	size_t j = i;
+	while (1) {
+		j = (j + 1) & mask;
+		if (!stab[j].path) break;
+		size_t k = stab[j].hash & mask;	// where it wants to be.
+		int stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+		if (stays) continue;
+		stab[i] = stab[j];
+		stab[j].path = NULL;
+		i = j;
+	}
+} // forgetstat()
+
+void
+clearstats(void)
+{ /* Forget everything, at the start of a run say. */
+	size_t i;
+	for (i = 0; i < stabsize; i++) free(stab[i].path);
+	free(stab);
+	stab = NULL;
+	stabsize = stabused = 0;
+} // clearstats()
+
+size_t
+statslot(const char *path, size_t hash)
+{ /* The slot that holds path, or the empty one where it would go. */
+	size_t mask = stabsize - 1;
+	size_t i = hash & mask;
+	while (stab[i].path) {
+		if (stab[i].hash == hash && strcmp(stab[i].path, path) == 0) break;
+		i = (i + 1) & mask;
+	}
+	return i;
+} // statslot()
+
+size_t
+strhash(const char *s)
+{ /* FNV-1a */
+	uint64_t h = 14695981039346656037ULL;
+	for ( ; *s; s++) {
+		h ^= (unsigned char)*s;
+		h *= 1099511628211ULL;
+	}
+	return h;
+} // strhash()
+
+void
+growstats(void)
+{ /* Double the table, or make the first one. */
+	size_t oldsize = stabsize;
+	statent *old = stab;
+	stabsize = (oldsize) ? 2 * oldsize : 64;
+	stab = xmalloc(stabsize * sizeof(statent));
+	memset(stab, 0, stabsize * sizeof(statent));
+	size_t i;
+	for (i = 0; i < oldsize; i++) {
+		if (!old[i].path) continue;
+		size_t j = old[i].hash & (stabsize - 1);
+		while (stab[j].path) j = (j + 1) & (stabsize - 1);
+		stab[j] = old[i];
+	}
+	free(old);
+} // growstats()
+
@@ -27,6 +27,7 @@
 
 #define _GNU_SOURCE 1
 #include <stdio.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
@@ -104,4 +105,43 @@ char
 void
 dounlink(const char *p);
 
+/* The *at() versions take a dir fd that the caller holds open, path is
+ * relative to it unless absolute, and AT_FDCWD works as usual. Paths
+ * are resolved from the dir rather than from / each time, and there is
+ * no need for chdir(), which every thread shares.
+ * */
+mdata
+*readfileat(int dirfd, const char *fn, int fatal, size_t extra);
+
+void
+writefileat(int dirfd, const char *fn, const char *fro, const char *to,
+			const char *opnmode);
+
+int
+exists_fileat(int dirfd, const char *fn);
+
+void
+dolinkat(int frofd, const char *fro, int tofd, const char *to);
+
+void
+dounlinkat(int dirfd, const char *p, int flags);
+
+int
+writeiov(int fd, const iolist_t *il);
+
+void
+writefileiov(const char *fn, const iolist_t *il, const char *fmode);
+
+int
+cachedstat(const char *path, unsigned mask, struct statx *st);
+
+void
+prefetchstats(char **paths, unsigned mask);
+
+void
+forgetstat(int dirfd, const char *path);
+
+void
+clearstats(void);
+
 #endif
@@ -21,13 +21,11 @@
 #include "files.h"
 #include "gopt.h"
 
+static void addword(char **list, const char *word);
 
 options_t process_options(int argc, char **argv)
 {
-	synopsis = thesynopsis();
-	helptext = thehelp();
-
-	optstring = ":hd:ox:n:";	// initialise
+	const char *optstring = ":hd:ox:n:fp:biDCl:usge:F:B:PUL";	// initialise
 
 	/* declare and set defaults for local variables. */
 
@@ -36,13 +34,9 @@ options_t process_options(int argc, char **argv)
 	// initialise non-zero defaults below
 
 	int c;
-	const int max = PATH_MAX;
-	char joinbuffer[PATH_MAX];	// collects list of extra software.
-	joinbuffer[0] = 0;
-	char databuffer[PATH_MAX];	// collects list of other data.
-	databuffer[0] = 0;
-	char optionsbuffer[PATH_MAX];	// collects list of options codes.
-	optionsbuffer[0] = 0;
+	char *joinbuffer = NULL;	// collects list of extra software.
+	char *databuffer = NULL;	// collects list of other data.
+	char *optionsbuffer = NULL;	// collects list of options codes.
 
 	while(1) {
 		int this_option_optind = optind ? optind : 1;
@@ -53,6 +47,22 @@ options_t process_options(int argc, char **argv)
 		{"extra-dist",	1,	0,	'x' },
 		{"with-options",0,	0,	'o' },
 		{"options-list",1,	0,	'n' },
+		{"fast-options",0,	0,	'f' },
+		{"profile",		1,	0,	'p' },
+		{"with-bench",	0,	0,	'b' },
+		{"init-config",	0,	0,	'i' },
+		{"daemon",		0,	0,	'D' },
+		{"client",		0,	0,	'C' },
+		{"link-mode",	1,	0,	'l' },
+		{"update",		0,	0,	'u' },
+		{"store",		0,	0,	's' },
+		{"gc",			0,	0,	'g' },
+		{"emit",		1,	0,	'e' },
+		{"options-file",1,	0,	'F' },
+		{"build-system",1,	0,	'B' },
+		{"pch",			0,	0,	'P' },
+		{"unity",		0,	0,	'U' },
+		{"complib",		0,	0,	'L' },
 		{0,	0,	0,	0 }
 		};
 
@@ -71,18 +81,73 @@ options_t process_options(int argc, char **argv)
 		dohelp(0);
 		break;
 		case 'd':	// other software dependencies for Makefile.am
-		strjoin(joinbuffer, ' ',optarg, max);
+		addword(&joinbuffer, optarg);
 		break;
 		case 'o':	// just set a flag for main()
 		// deal with -n seen before -o, or -o not done.
 		opts.hasopts = 1;
 		break;
 		case 'n':	// code strings for options generation.
-		strjoin(optionsbuffer, ' ', optarg, max);
+		addword(&optionsbuffer, optarg);
+		opts.hasopts = 1;	// generates -o option anyway
+		break;
+		case 'f':	// perfect hash option lookup in generated gopt.c
+		opts.fast_options = 1;
 		opts.hasopts = 1;	// generates -o option anyway
 		break;
+		case 'p':	// template profile for the main program
+		free(opts.profile);
+		opts.profile = xstrdup(optarg);
+		break;
+		case 'b':	// benchmark harness in bench/
+		opts.with_bench = 1;
+		break;
+		case 'i':	// editable copies of the stubs
+		opts.init_config = 1;
+		break;
+		case 'D':	// keep state warm and take requests
+		opts.daemon = 1;
+		break;
+		case 'C':	// pass the request to the daemon
+		opts.client = 1;
+		break;
+		case 'l':	// hard, reflink, symlink or copy
+		free(opts.link_mode);
+		opts.link_mode = xstrdup(optarg);
+		break;
+		case 'u':	// write only what has changed
+		opts.update = 1;
+		break;
+		case 's':	// dedupe autotools files
+		opts.store = 1;
+		break;
+		case 'g':	// remove unused store objects
+		opts.gc = 1;
+		break;
+		case 'e':	// dir or tar
+		free(opts.emit);
+		opts.emit = xstrdup(optarg);
+		break;
+		case 'F':	// one option code per line, for long lists
+		free(opts.options_file);
+		opts.options_file = xstrdup(optarg);
+		opts.hasopts = 1;
+		break;
+		case 'B':	// autotools, make or ninja
+		free(opts.build_system);
+		opts.build_system = xstrdup(optarg);
+		break;
+		case 'P':	// precompiled common header
+		opts.pch = 1;
+		break;
+		case 'U':	// one translation unit target
+		opts.unity = 1;
+		break;
+		case 'L':	// link the components compiled
+		opts.complib = 1;
+		break;
 		case 'x':	// other data for Makefile.am
-		strjoin(databuffer, ' ',optarg, max);
+		addword(&databuffer, optarg);
 		break;
 		case ':':
 			fprintf(stderr, "Option %s requires an argument\n",
@@ -96,16 +161,29 @@ options_t process_options(int argc, char **argv)
 		break;
 		} // switch()
 	} // while()
-	opts.software_deps = xstrdup(joinbuffer);
-	if (strlen(databuffer)) {
-		opts.extra_data = xstrdup(databuffer);
-	}
-	if (strlen(optionsbuffer)) {
-		opts.options_list = xstrdup(optionsbuffer);
-	}
+	opts.software_deps = (joinbuffer) ? joinbuffer : xstrdup("");
+	opts.extra_data = databuffer;
+	opts.options_list = optionsbuffer;
 	return opts;
 } // process_options()
 
+void
+addword(char **list, const char *word)
+{ /* Join word onto the malloc'd list with a space between, *list may
+   * be NULL. Grows to any length, unlike strjoin() on a fixed buffer.
+  */
+	size_t have = (*list) ? strlen(*list) : 0;
+	size_t len = strlen(word);
+	char *p = realloc(*list, have + len + 2);
+	if (!p) {
+		fputs("Out of memory.\n", stderr);
+		exit(EXIT_FAILURE);
+	}
+	if (have) p[have++] = ' ';
+	memcpy(p + have, word, len + 1);
+	*list = p;
+} // addword()
+
 void dohelp(int forced)
 {
   char command[PATH_MAX];
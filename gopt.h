@@ -21,15 +21,28 @@
 #ifndef GOPT_H
 #define GOPT_H
 #include "str.h"
-char *optstring;
-char *helptext;
-char *synopsis;
 
 typedef struct options_t {
 	int hasopts;			// main() needs this flag.
 	char *software_deps;	// source files to include.
 	char *extra_data;		// eg stuff like config files.
 	char *options_list;		// code to describe options for new program.
+	int fast_options;		// generate gopt.c without getopt_long().
+	char *profile;			// names the set of stubs for main().
+	int with_bench;			// generate bench/ and `make bench`.
+	int init_config;		// copy the built in stubs to ~/.config.
+	int daemon;				// serve requests over a unix socket.
+	int client;				// send this request to the daemon.
+	char *link_mode;		// how components get into the project.
+	int update;				// regenerate an existing project.
+	int store;				// share autotools files via the store.
+	int gc;					// clean the store and quit.
+	char *emit;				// dir, or tar to stream it to stdout.
+	char *options_file;		// option codes, one per line.
+	char *build_system;		// autotools, make or ninja.
+	int pch;				// precompiled common.h.
+	int unity;				// `make unity` target.
+	int complib;			// components from libcomponents.a.
 } options_t;
 
 void dohelp(int forced);
@@ -0,0 +1,2503 @@
+/*    libnewprogram.c
+ *
+ * Copyright 2017 Robert L (Bob) Parker rlp1938@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <limits.h>
+#include <linux/limits.h>
+#include <errno.h>
+#include <ftw.h>
+#include <dirent.h>
+#include "str.h"
+#include "files.h"
+#include "stubs.h"
+#include "store.h"
+#include "tar.h"
+#include "libnewprogram.h"
+
+typedef struct progid { /* vars to use in Makefile.am etc */
+	char *dir;		// directory name.
+	char *exe;		// program name.
+	char *src;		// source code name.
+	char *thr;		// three letter abbreviation.
+	char *man;		// man page name.
+	char *author;	// program author name.
+	char *email;	// author email address,
+} progid;
+
+typedef struct profile_t {	/* template set for the main program */
+	char	*name;			// as given to --profile.
+	char	*mainstub;		// stub the main C program is made from.
+	char	*srcfiles;		// more stubs to copy, eg "sio.c sio.h".
+	char	*options;		// options the main stub depends on.
+} profile_t;
+
+static const profile_t profiles[] = {
+	{"main",	"mainC",	NULL,	NULL},
+	{"stream",	"streamC",	"sio.c sio.h",	"ooutput:"},
+	{NULL,	NULL,	NULL,	NULL}
+};
+
+/* Ways of getting a file into the project dir, in the order they are
+ * tried when the one asked for can't be done. */
+enum { LK_HARD, LK_REFLINK, LK_SYMLINK, LK_COPY };
+static const char *linkmodes[] = { "hard", "reflink", "symlink", "copy",
+									NULL };
+
+/* What the project is built with, --build-system. */
+enum { BS_AUTOTOOLS, BS_MAKE, BS_NINJA };
+static const char *buildsystems[] = { "autotools", "make", "ninja", NULL };
+// What each writes, and what its stubs are called in front of eg pch.mak.
+static const char *buildfiles[] = { "Makefile.am", "Makefile",
+									"build.ninja" };
+static const char *buildstubs[] = { "", "plain", "ninja" };
+
+typedef struct oplist_t {	/* var to use when generating options */
+	char	*shoptname;		// short options name, "" if long only.
+	char	*longoptname;	// long options name.
+	char	*dataname;		// name of the opts variable.
+	char	*field;			// its name in options_t.
+	char	*help;			// from --options-file, NULL for the default.
+	int		optarg;			// 0,1 or 2.
+	int		val;			// what getopt_long() returns for it.
+} oplist_t;
+
+typedef struct outfile_t {	/* a file made in memory, not yet written */
+	char *name;				// relative to the project dir.
+	iolist_t il;			// its pieces, in buffers of genctx_t keep.
+	int append;				// add to the file on disk, don't replace it.
+	int seed;				// the user's to edit, --update leaves it be.
+} outfile_t;
+
+typedef struct tarmem_t {	/* a file for the --emit tar stream */
+	char *name;				// relative to the project dir.
+	iolist_t il;			// its content if it was made here,
+	char *src;				// else the file that has it.
+} tarmem_t;
+
+struct genctx_t {	/* everything one generation works with */
+	const genreq_t *req;
+	progid *pi;
+	int dirfd;				// the project dir, for the *at() calls.
+	outfile_t *out;			// files waiting for flushout().
+	size_t nout;
+	size_t outcap;
+	char **keep;			// what their pieces are in, see keepout().
+	size_t nkeep;
+	size_t keepcap;
+	tarmem_t *tm;			// what emittar() streams, see tarlater().
+	size_t ntm;
+	size_t tmcap;
+	char err[PATH_MAX];		// why npgenerate() failed.
+	char libdir[PATH_MAX];	// libcomponents.a's version, "" without.
+	int libfd;				// holds it from storegc(), see complib().
+	oplist_t **ol;			// the options, NULL terminated.
+	size_t nol;
+	size_t olcap;
+	mdata bufso;			// the rest collect code for the targets
+	mdata buflo;			// in the gopt stubs, see mdprintf().
+	mdata bufop;
+	mdata bufhl;
+	mdata bufsy;
+	mdata buffo;
+	mdata bufsm;
+	mdata bufph;
+};
+
+static int writeproject(genctx_t *, const profile_t *, char *, int,
+						const char *, const char *, char *);
+static int seterr(genctx_t *, const char *, ...);
+static int seterrno(genctx_t *, const char *);
+static char *inproject(genctx_t *, char *, const char *);
+static mdata *slurp(genctx_t *, int, const char *, size_t);
+static mdata *getfile(genctx_t *, const char *, size_t);
+static int putfile(genctx_t *, const char *, const char *, const char *,
+					const char *);
+static int putiov(genctx_t *, const char *, const iolist_t *,
+					const char *);
+static int putmd(genctx_t *, const char *, mdata *, const char *);
+static void keepout(genctx_t *, void *);
+static void keepmd(genctx_t *, mdata *);
+static int putstr(genctx_t *, const char *, const char *);
+static int putstub(genctx_t *, const char *, const char *);
+static outfile_t *staged(genctx_t *, const char *);
+static void markseed(genctx_t *, const char *);
+static int flushout(genctx_t *);
+static int writeout(genctx_t *, outfile_t *);
+static void freeout(genctx_t *);
+static void freekeep(genctx_t *);
+static void tarlater(genctx_t *, const char *, const iolist_t *,
+						const char *, int);
+static tarmem_t *tarmember(genctx_t *, const char *);
+static int addscratch(genctx_t *, const char *, const char *);
+static int cmptarmem(const void *, const void *);
+static int emittar(genctx_t *, const char *, const char *);
+static void freetar(genctx_t *);
+static int runtool(genctx_t *, const char *);
+static int needtool(genctx_t *, const char *, const char **);
+static progid *makeprogname(const char *);
+static void ulstr(int, char *);
+static void destroyprogid(progid *);
+static char *joinoptions(const char *, const char *);
+static int writemakefile_am(genctx_t *, char *);
+static int updmakefile_am(genctx_t *, char *);
+static char *swdepends(const char *);
+static char *cfgpath(genctx_t *, char *);
+static char *makefullpath(char *, char *);
+static int linkorcopy(genctx_t *, const char *, const char *, char *);
+static int getcomplib(genctx_t *, const char *, const char *, char **);
+static int getlinkmode(genctx_t *, const char *, const char *);
+static int linkin(genctx_t *, const char *, const char *, int, int);
+static void probedeps(char **, const char **);
+static void forgetin(genctx_t *, const char *);
+static int extramakefile_am(genctx_t *, const char *);
+static int benchmakefile_am(genctx_t *, char *, char *);
+static int genbench(genctx_t *);
+static int getbuildsystem(genctx_t *, const char *);
+static int writebuildfile(genctx_t *, int, const profile_t *, int, char *);
+static void ninjaedges(mdata *, mdata *, const char *, int, int);
+static int addbuildstub(genctx_t *, int, const char *, char **, char **);
+static int addunitypch(genctx_t *, int, const char *);
+static const profile_t *getprofile(const char *);
+static char *stubname(const char *);
+static int gensrcfiles(genctx_t *, const profile_t *, char *, int);
+static int genoptions(genctx_t *, char *);
+static int words2ol(genctx_t *, char *);
+static int readoptfile(genctx_t *, const char *);
+static int addopt(genctx_t *, char *, const char *, const char *, size_t);
+static int checkopts(genctx_t *);
+static int cmpstrp(const void *, const void *);
+static void freeol(genctx_t *);
+static char *optnames(char *, const oplist_t *);
+static char *caselabel(char *, const oplist_t *);
+static char *mdroom(mdata *, size_t);
+static void mdprintf(mdata *, const char *, ...);
+static void mdcstr(mdata *, const char *);
+static char *mdtext(mdata *);
+static void freetargets(genctx_t *);
+static int updatemainfile(genctx_t *, const char *, oplist_t **);
+static int updategoptHfile(genctx_t *, const char *, oplist_t **);
+static int updategoptCfile(genctx_t *, const char * ,oplist_t **);
+static int updatefgoptCfile(genctx_t *, const char * ,oplist_t **);
+static void sotarget(genctx_t *, oplist_t *);
+static void lotarget(genctx_t *, oplist_t *);
+static void optarget(genctx_t *, oplist_t *);
+static void hltarget(genctx_t *, oplist_t *);
+static void sytarget(genctx_t *);
+static void fotarget(genctx_t *, oplist_t *, size_t);
+static int phtarget(genctx_t *, oplist_t **);
+static int phplace(const unsigned *, size_t, unsigned, unsigned,
+					unsigned short *, short *);
+static unsigned phash(const char *, size_t, unsigned);
+static unsigned phmix(unsigned);
+static int addautotools(genctx_t *, const profile_t *);
+static int writeconfigure_ac(genctx_t *, const profile_t *, const char *);
+static int updconfigure_ac(genctx_t *, iolist_t *);
+static char *acstem(genctx_t *, const profile_t *, const char *, size_t);
+static void acjoin(mdata *, const char *, char **, size_t);
+static void storeaux(genctx_t *);
+static int tweakmain(genctx_t *, const char *);
+static char *mkscratch(genctx_t *);
+static int rmentry(const char *, const struct stat *, int, struct FTW *);
+
+genctx_t
+*npnew(void)
+{ /* A context for npgenerate(), one for each thread using it. */
+	genctx_t *ctx = xmalloc(sizeof(genctx_t));
+	memset(ctx, 0, sizeof(genctx_t));
+	return ctx;
+} // npnew()
+
+void
+npfree(genctx_t *ctx)
+{
+	free(ctx);
+} // npfree()
+
+const char
+*nperror(const genctx_t *ctx)
+{ /* Why the last npgenerate() with ctx failed. */
+	return ctx->err;
+} // nperror()
+
+int
+npgenerate(genctx_t *ctx, const genreq_t *req)
+{ /* Write the project that req describes into its dir under progdir.
+   * Returns 0, or -1 with the reason in nperror(ctx). The working dir
+   * is not changed.
+  */
+	memset(ctx, 0, sizeof(genctx_t));
+	ctx->req = req;
+	ctx->dirfd = -1;
+	ctx->libfd = -1;
+	clearstats();	// what was true last run may not be now.
+	if (!req->name || !req->name[0]) {
+		return seterr(ctx, "No project name provided.");
+	}
+	if (strlen(req->name) > NAME_MAX - 3 || strchr(req->name, '/')) {
+		return seterr(ctx, "Not a usable project name: %s", req->name);
+	}
+	if (req->tar && req->update) {
+		return seterr(ctx, "There is nothing to update in a tar stream.");
+	}
+	const profile_t *prof = getprofile(req->profile);
+	if (!prof) return seterr(ctx, "No such profile: %s", req->profile);
+	// the main stub of the profile may need options of its own.
+	char *oplist = joinoptions(req->options_list, prof->options);
+	int hasopts = (req->hasopts || prof->options || req->options_file);
+	progid *pi = ctx->pi = makeprogname(req->name);
+	if (req->log) {
+		fprintf(req->log, "%s %s %s %s %s\n",pi->dir, pi->exe, pi->src,
+					pi->man, pi->thr);
+	}
+	// get location of boilerplate code (if any), and source library
+	int res = -1;
+	char *prog = cfgpath(ctx, "progdir");
+	char *stub = cfgpath(ctx, "stubdir");
+	char *comp = cfgpath(ctx, "compdir");
+	if (prog && stub && comp) {
+		char *tmp = pi->dir;	// preserve it to free() it.
+		/* A tar stream is made in memory, with a scratch dir only for
+		 * the autotools to run in. */
+		int am = (getbuildsystem(ctx, req->build_system) == BS_AUTOTOOLS);
+		char *scratch = (req->tar && am) ? mkscratch(ctx) : NULL;
+		if (scratch) {
+			char path[PATH_MAX];
+			snprintf(path, sizeof(path), "%s/%s", scratch, pi->dir);
+			pi->dir = xstrdup(path);
+		} else {
+			pi->dir = makefullpath(prog, pi->dir);
+		}
+		char *compdir = makefullpath(prog, comp);
+		char *stubdir = makefullpath(prog, stub);
+		if (req->log) {
+			fprintf(req->log, "%s\n%s\n%s\n", pi->dir, compdir, stubdir);
+		}
+		char *extras = swdepends(req->software_deps);
+		int libok = (getcomplib(ctx, stubdir, compdir, &extras) == 0);
+		if (libok && (!req->tar || !am || scratch)) {
+			res = writeproject(ctx, prof, oplist, hasopts, stubdir,
+								compdir, extras);
+		}
+		if (res == 0 && req->tar) {
+			res = emittar(ctx, tmp, (scratch) ? pi->dir : NULL);
+		}
+		if (scratch) {
+			nftw(scratch, rmentry, 16, FTW_DEPTH | FTW_PHYS);
+			free(scratch);
+		}
+		vfree(tmp, compdir, stubdir, NULL);
+		free(extras);
+	}
+	free(prog);
+	free(stub);
+	free(comp);
+	free(oplist);
+	freeout(ctx);	// left over only if there was an error.
+	freetar(ctx);
+	if (ctx->dirfd != -1) close(ctx->dirfd);
+	ctx->dirfd = -1;
+	if (ctx->libfd != -1) close(ctx->libfd);	// storegc() may go ahead.
+	ctx->libfd = -1;
+	destroyprogid(pi);
+	ctx->pi = NULL;
+	return res;
+} // npgenerate()
+
+int
+writeproject(genctx_t *ctx, const profile_t *prof, char *oplist,
+				int hasopts, const char *stubdir, const char *compdir,
+				char *extras)
+{ /* Everything that goes in the project dir, in the order that each
+   * step needs the one before it.
+  */
+	progid *pi = ctx->pi;
+	const genreq_t *req = ctx->req;
+	int bs = getbuildsystem(ctx, req->build_system);
+	if (bs == -1) return -1;
+	int am = (bs == BS_AUTOTOOLS);
+	// all else in the project is reached through dirfd, -1 for a tar
+	// stream without autotools as nothing goes on disk.
+	if (!req->tar || am) {
+		forgetstat(AT_FDCWD, pi->dir);
+		if (mkdir(pi->dir, 0775) == -1 && errno != EEXIST) {
+			return seterrno(ctx, pi->dir);
+		}
+		ctx->dirfd = open(pi->dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (ctx->dirfd == -1) return seterrno(ctx, pi->dir);
+	}
+	// create the Makefile.am for the new program
+	if (am) {
+		if (writemakefile_am(ctx, "am.mak") == -1) return -1;
+		if (updmakefile_am(ctx, extras) == -1) return -1;
+	}
+	// copy in boilerplate and link library source
+	if (linkorcopy(ctx, stubdir, compdir, extras) == -1) return -1;
+	if (ctx->libdir[0]) {	// in place of the components' .c files.
+		char lib[] = "libcomponents.a";
+		if (linkorcopy(ctx, stubdir, compdir, lib) == -1) return -1;
+	}
+	if (am && hasopts) {	// add gopt.h and gopt.c to Makefile.am
+		if (updmakefile_am(ctx, " gopt.c gopt.h") == -1) return -1;
+	}
+	if (am && prof->srcfiles) {	// sources that come with the profile
+		char buf[NAME_MAX];
+		sprintf(buf, " %s", prof->srcfiles);
+		if (updmakefile_am(ctx, buf) == -1) return -1;
+	}
+	// add extra-dist to Makefile.am if optioned.
+	if (am && req->extra_data) {
+		if (extramakefile_am(ctx, req->extra_data) == -1) return -1;
+	}
+	// add the benchmark harness if optioned.
+	if (req->with_bench) {
+		if (am && benchmakefile_am(ctx, "bench.mak", extras) == -1) {
+			return -1;
+		}
+		if (genbench(ctx) == -1) return -1;
+	}
+	// the header to precompile is the user's, as is the main source.
+	if (req->pch) {
+		if (putstub(ctx, "commonH", "common.h") == -1) return -1;
+		markseed(ctx, "common.h");
+		if (am && updmakefile_am(ctx, " common.h") == -1) return -1;
+	}
+	if (am && ctx->libdir[0]) {
+		char *find[] = {"exe%s", NULL};
+		char *repl[] = {pi->exe};
+		if (addbuildstub(ctx, bs, "complib.mak", find, repl) == -1) {
+			return -1;
+		}
+	}
+	if (am && addunitypch(ctx, bs, "") == -1) return -1;
+	// generate C program regardless
+	if (gensrcfiles(ctx, prof, oplist, hasopts) == -1) return -1;
+	if (tweakmain(ctx, prof->mainstub) == -1) return -1;
+	// Generate the autotools, or what stands in for them.
+	if (am) {
+		if (addautotools(ctx, prof) == -1) return -1;
+	} else {
+		if (writebuildfile(ctx, bs, prof, hasopts, extras) == -1) return -1;
+	}
+	if (flushout(ctx) == -1) return -1;
+	if (req->tar) return 0;	// the scratch dir has nothing to keep.
+	if (!am) return 0;	// the store holds only autotools files.
+	const char *cp = getcfg("store");
+	if (req->store || (cp && strcmp(cp, "yes") == 0)) storeaux(ctx);
+	return 0;
+} // writeproject()
+
+int
+seterr(genctx_t *ctx, const char *fmt, ...)
+{ /* Record why generation failed, returns -1 for the caller to pass
+   * back. */
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(ctx->err, sizeof(ctx->err), fmt, ap);
+	va_end(ap);
+	return -1;
+} // seterr()
+
+int
+seterrno(genctx_t *ctx, const char *what)
+{ /* As perror() but recorded in ctx. */
+	char buf[128];
+	return seterr(ctx, "%s: %s", what, strerror_r(errno, buf,
+					sizeof(buf)));
+} // seterrno()
+
+char
+*inproject(genctx_t *ctx, char *buf, const char *name)
+{ /* Path of name in the project dir into buf, which must be PATH_MAX.
+   * Only for what has to have a path, the store and reflink(), all else
+   * goes through ctx->dirfd.
+  */
+	snprintf(buf, PATH_MAX, "%s/%s", ctx->pi->dir, name);
+	return buf;
+} // inproject()
+
+mdata
+*slurp(genctx_t *ctx, int dirfd, const char *path, size_t extra)
+{ /* As readfileat(dirfd, path, 1, extra) but NULL on error. */
+	int fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		seterrno(ctx, path);
+		return NULL;
+	}
+	struct stat sb;
+	if (fstat(fd, &sb) == -1) {
+		seterrno(ctx, path);
+		close(fd);
+		return NULL;
+	}
+	size_t fsize = sb.st_size;
+	mdata *md = init_mdata();
+	md->fro = xmalloc(fsize + extra + 1);
+	memset(md->fro + fsize, 0, extra + 1);
+	md->to = md->fro;
+	md->limit = md->fro + fsize + extra;
+	while ((size_t)(md->to - md->fro) < fsize) {
+		ssize_t got = read(fd, md->to, fsize - (md->to - md->fro));
+		if (got == -1 && errno == EINTR) continue;
+		if (got <= 0) {
+			if (got == 0) errno = EIO;	// shrank under us.
+			seterrno(ctx, path);
+			close(fd);
+			free_mdata(md);
+			return NULL;
+		}
+		md->to += got;
+	}
+	close(fd);
+	return md;
+} // slurp()
+
+mdata
+*getfile(genctx_t *ctx, const char *name, size_t extra)
+{ /* As slurp() for name in the project dir, or a copy of it if it has
+   * been made but not written yet or is only in the tar stream.
+  */
+	outfile_t *of = staged(ctx, name);
+	tarmem_t *tm = (!of && ctx->dirfd == -1) ? tarmember(ctx, name) : NULL;
+	if (tm && tm->src) return slurp(ctx, AT_FDCWD, tm->src, extra);
+	if (!of && !tm) return slurp(ctx, ctx->dirfd, name, extra);
+	const iolist_t *il = (of) ? &of->il : &tm->il;
+	size_t len = il->len;
+	mdata *md = init_mdata();
+	md->fro = xmalloc(len + extra + 1);
+	iolgather(il, md->fro);
+	memset(md->fro + len, 0, extra + 1);
+	md->to = md->fro + len;
+	md->limit = md->to + extra;
+	return md;
+} // getfile()
+
+int
+putfile(genctx_t *ctx, const char *name, const char *fro, const char *to,
+			const char *mode)
+{ /* As writefile() for name in the project dir, mode "w" or "a", except
+   * that it is only made in memory, see flushout(). fro..to is copied,
+   * putmd() and putiov() don't.
+  */
+	size_t len = to - fro;
+	char *copy = xmalloc(len + 1);
+	if (len) memcpy(copy, fro, len);
+	keepout(ctx, copy);
+	struct iovec iov = {copy, len};
+	iolist_t il = {&iov, 1, 1, len};
+	return putiov(ctx, name, &il, mode);
+} // putfile()
+
+int
+putmd(genctx_t *ctx, const char *name, mdata *md, const char *mode)
+{ /* As putfile() for what md holds, md then goes with the staged files
+   * rather than being copied.
+  */
+	struct iovec iov = {md->fro, md->to - md->fro};
+	iolist_t il = {&iov, 1, 1, iov.iov_len};
+	int res = putiov(ctx, name, &il, mode);
+	keepmd(ctx, md);
+	return res;
+} // putmd()
+
+int
+putiov(genctx_t *ctx, const char *name, const iolist_t *il,
+			const char *mode)
+{ /* As putfile() for the pieces of il, which are not copied. What they
+   * are in must last until flushout(), hand it to keepout() in place of
+   * freeing it. flushout() writes them with writev().
+  */
+	outfile_t *of = staged(ctx, name);
+	if (!of) {
+		if (ctx->nout == ctx->outcap) {
+			ctx->outcap = (ctx->outcap) ? 2 * ctx->outcap : 16;
+			ctx->out = realloc(ctx->out, ctx->outcap * sizeof(outfile_t));
+			if (!ctx->out) {
+				fputs("Out of memory.\n", stderr);
+				exit(EXIT_FAILURE);
+			}
+		}
+		of = &ctx->out[ctx->nout++];
+		memset(of, 0, sizeof(outfile_t));
+		of->name = xstrdup((char *)name);
+		of->append = (mode[0] == 'a');
+	} else if (mode[0] == 'w') {
+		of->il.n = of->il.len = 0;
+		of->append = 0;
+	}
+	size_t i;
+	for (i = 0; i < il->n; i++) {
+		ioladd(&of->il, il->iov[i].iov_base, il->iov[i].iov_len);
+	}
+	return 0;
+} // putiov()
+
+void
+keepout(genctx_t *ctx, void *p)
+{ /* p, from malloc(), is freed with the staged files by freeout(). */
+	if (!p) return;
+	if (ctx->nkeep == ctx->keepcap) {
+		ctx->keepcap = (ctx->keepcap) ? 2 * ctx->keepcap : 32;
+		ctx->keep = realloc(ctx->keep, ctx->keepcap * sizeof(char *));
+		if (!ctx->keep) {
+			fputs("Out of memory.\n", stderr);
+			exit(EXIT_FAILURE);
+		}
+	}
+	ctx->keep[ctx->nkeep++] = p;
+} // keepout()
+
+void
+keepmd(genctx_t *ctx, mdata *md)
+{ /* As keepout() for what md holds, md itself is freed now. */
+	keepout(ctx, md->fro);
+	free(md);
+} // keepmd()
+
+outfile_t
+*staged(genctx_t *ctx, const char *name)
+{ /* The file called name that is waiting to be written, or NULL. */
+	size_t i;
+	for (i = 0; i < ctx->nout; i++) {
+		if (strcmp(ctx->out[i].name, name) == 0) return &ctx->out[i];
+	}
+	return NULL;
+} // staged()
+
+void
+markseed(genctx_t *ctx, const char *name)
+{ /* name is only a starting point for the user, see writeout(). */
+	outfile_t *of = staged(ctx, name);
+	if (of) of->seed = 1;
+} // markseed()
+
+int
+flushout(genctx_t *ctx)
+{ /* Write the files made so far, as anything run from here on will
+   * expect to find them on disk.
+  */
+	size_t i;
+	int res = 0;
+	for (i = 0; i < ctx->nout && res == 0; i++) {
+		res = writeout(ctx, &ctx->out[i]);
+	}
+	freeout(ctx);
+	return res;
+} // flushout()
+
+int
+writeout(genctx_t *ctx, outfile_t *of)
+{ /* Write of to the project dir. With --update, files that are the
+   * user's to edit are left alone if they exist and others are written
+   * only if their content differs from what is there. Without a project
+   * dir it goes straight to the tar stream.
+  */
+	const char *path = of->name;
+	const genreq_t *req = ctx->req;
+	if (ctx->dirfd == -1) {
+		tarlater(ctx, path, &of->il, NULL, of->append);
+		return 0;
+	}
+	if (req->update) {
+		struct stat sb;
+		int have = (fstatat(ctx->dirfd, path, &sb, 0) == 0);
+		if (have && (of->seed || of->append)) return 0;
+		if (have && S_ISREG(sb.st_mode)
+				&& (size_t)sb.st_size == of->il.len) {
+			mdata *md = slurp(ctx, ctx->dirfd, path, 0);
+			if (!md) return -1;
+			// piece by piece, there is no need to gather them.
+			const char *cp = md->fro;
+			int same = 1;
+			size_t i;
+			for (i = 0; i < of->il.n && same; i++) {
+				const struct iovec *v = &of->il.iov[i];
+				same = (memcmp(cp, v->iov_base, v->iov_len) == 0);
+				cp += v->iov_len;
+			}
+			free_mdata(md);
+			if (same) return 0;
+		}
+		if (req->log) fprintf(req->log, "Updated %s\n", of->name);
+	}
+	int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+	flags |= (of->append) ? O_APPEND : O_TRUNC;
+	forgetin(ctx, path);
+	int fd = openat(ctx->dirfd, path, flags, 0666);
+	if (fd == -1) return seterrno(ctx, path);
+	if (writeiov(fd, &of->il) == -1) {
+		seterrno(ctx, path);
+		close(fd);
+		return -1;
+	}
+	if (close(fd) == -1) return seterrno(ctx, path);
+	return 0;
+} // writeout()
+
+void
+freeout(genctx_t *ctx)
+{
+	size_t i;
+	for (i = 0; i < ctx->nout; i++) {
+		free(ctx->out[i].name);
+		freeiol(&ctx->out[i].il);
+	}
+	free(ctx->out);
+	ctx->out = NULL;
+	ctx->nout = ctx->outcap = 0;
+	// the tar stream still has the pieces, freetar() frees them.
+	if (!ctx->ntm) freekeep(ctx);
+} // freeout()
+
+void
+freekeep(genctx_t *ctx)
+{ /* What keepout() was given. */
+	size_t i;
+	for (i = 0; i < ctx->nkeep; i++) free(ctx->keep[i]);
+	free(ctx->keep);
+	ctx->keep = NULL;
+	ctx->nkeep = ctx->keepcap = 0;
+} // freekeep()
+
+int
+putstr(genctx_t *ctx, const char *name, const char *s)
+{ /* As str2file(name, s, "a") in the project dir. */
+	size_t len = strlen(s);
+	char *line = xmalloc(len + 2);
+	memcpy(line, s, len);
+	strcpy(line + len, "\n");
+	keepout(ctx, line);
+	struct iovec iov = {line, len + 1};
+	iolist_t il = {&iov, 1, 1, len + 1};
+	return putiov(ctx, name, &il, "a");
+} // putstr()
+
+int
+putstub(genctx_t *ctx, const char *stub, const char *name)
+{ /* As stub2file() to name in the project dir. */
+	mdata *md = getstub(stub);
+	return putmd(ctx, name, md, "w");
+} // putstub()
+
+int
+runtool(genctx_t *ctx, const char *cmd)
+{ /* As xsystem(cmd, 1) but run in the project dir and returning -1
+   * where xsystem() would exit().
+  */
+	if (flushout(ctx) == -1) return -1;
+	pid_t pid = fork();
+	if (pid == -1) return seterrno(ctx, "fork");
+	if (pid == 0) {
+		if (fchdir(ctx->dirfd) == -1) _exit(126);
+		// stdout may be the tar stream, what the tool says is not for it.
+		if (ctx->req->tar && dup2(STDERR_FILENO, STDOUT_FILENO) == -1) {
+			_exit(126);
+		}
+		execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+		_exit(127);
+	}
+	int status;
+	while (waitpid(pid, &status, 0) == -1) {
+		if (errno != EINTR) return seterrno(ctx, "waitpid");
+	}
+	if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+		return seterr(ctx, "Command \"%s\" returned non-zero result:"
+						" %d", cmd, WIFEXITED(status)
+						? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+	}
+	return 0;
+} // runtool()
+
+int
+needtool(genctx_t *ctx, const char *out, const char **ins)
+{ /* Whether the tool that makes out from ins has to be run. Always with
+   * a new project, with --update only if out is missing or older than
+   * any of ins, as make would decide.
+  */
+	if (!ctx->req->update) return 1;
+	struct stat sb;
+	if (fstatat(ctx->dirfd, out, &sb, 0) == -1) return 1;
+	struct timespec ot = sb.st_mtim;
+	for ( ; *ins; ins++) {
+		if (fstatat(ctx->dirfd, *ins, &sb, 0) == -1) return 1;
+		if (sb.st_mtim.tv_sec > ot.tv_sec || (sb.st_mtim.tv_sec ==
+				ot.tv_sec && sb.st_mtim.tv_nsec > ot.tv_nsec)) {
+			return 1;
+		}
+	}
+	return 0;
+} // needtool()
+
+progid
+*makeprogname(const char *pname)
+{	/* Create and fill in the progid struct with the values needed in
+	 * Makefile.am, ->exe = name, ->src = name.c, ->man = name.1
+	 * and ->thr = nam .
+	*/
+	char name[NAME_MAX], lcname[NAME_MAX];
+	progid *prid = xmalloc(sizeof(progid));
+	strcpy(name, pname);
+	ulstr('l', name);
+	strcpy(lcname, name);	// keep pristine lower case copy
+	prid->exe = xstrdup(name);
+	strcat(name, ".c");
+	prid->src = xstrdup(name);
+	strcpy(name, lcname);
+	strcat(name, ".1");
+	prid->man = xstrdup(name);
+	name[3] = 0;
+	prid->thr = xstrdup(name);	// 3 letter abbreviation
+	strcpy(name, lcname);
+	name[0] = toupper(name[0]);
+	prid->dir = xstrdup(name);
+	// to be filled in later
+	prid->author = NULL;
+	prid->email = NULL;
+
+	return prid;
+} // makeprogname()
+
+void
+ulstr(int ul, char *b)
+{	/* convert b to upper or lower case depending on value of ul */
+	size_t i;
+	switch (ul)
+	{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpointer-sign"
+		case 'u':
+			for (i = 0; i < strlen(b); i++) {
+				b[i] = toupper(b[i]);
+			}
+			break;
+		case 'l':
+			for (i = 0; i < strlen(b); i++) {
+				b[i] = tolower(b[i]);
+			}
+			break;
+#pragma GCC diagnostic pop
+		default:
+			b[0] = 0;	// trash the input string if ul is rubbish.
+			break;
+	}
+} // ulstr()
+
+void
+destroyprogid(progid *pi)
+{
+	vfree(pi->exe, pi->src, pi->man, pi->thr, pi->dir, pi->author,
+	pi->email, pi, NULL);
+} // destroyprogid()
+
+char
+*joinoptions(const char *list, const char *profopts)
+{ /* The options list with the options the profile needs after it, in
+   * a new string. NULL if there are neither.
+  */
+	if (!profopts) return (list) ? xstrdup((char *)list) : NULL;
+	if (!list) return xstrdup((char *)profopts);
+	size_t len = strlen(list) + strlen(profopts) + 2;
+	char *ol = xmalloc(len);
+	strcpy(ol, list);
+	strjoin(ol, ' ', (char *)profopts, len);
+	return ol;
+} // joinoptions()
+
+int
+writemakefile_am(genctx_t *ctx, char *amstub)
+{	/* Reads the Makefile.am stub , amstub and fills in the names
+	 * recorded at pi->, then writes Makefile.am
+	*/
+	progid *pi = ctx->pi;
+	char *pgotrain = cfgpath(ctx, "pgotrain");
+	if (!pgotrain) return -1;
+	// pgotrain may hold exe%s, which renderiov() would not look inside.
+	iolist_t pgo = {0};
+	char *find[] = {"exe%s", NULL};
+	char *exe[] = {pi->exe};
+	renderiov(&pgo, pgotrain, pgotrain + strlen(pgotrain), find, exe);
+	char *pgocmd = xmalloc(pgo.len + 1);
+	*iolgather(&pgo, pgocmd) = 0;
+	freeiol(&pgo);
+	iolist_t il = {0};
+	char *finds[] = {"pgo%s", "exe%s", "src%s", "man%s", "thr%s", NULL};
+	char *repls[] = {pgocmd, pi->exe, pi->src, pi->man, pi->thr};
+	renderstub(&il, amstub, finds, repls);
+	int res = putiov(ctx, "Makefile.am", &il, "w");
+	freeiol(&il);
+	free(pgotrain);
+	keepout(ctx, pgocmd);
+	return res;
+} // writemakefile_am()
+
+int
+updmakefile_am(genctx_t *ctx, char *swdeplist)
+{	/* Find ???_SOURCES= in Makefile.am and insert swdeplist before
+	 * the line end in that line
+	*/
+	if (!swdeplist) return 0;
+	char *pname = ctx->pi->exe;
+	char srchfor[NAME_MAX];
+	// Relies on exact formatting of _SOURCES
+	sprintf(srchfor, "%s_SOURCES=%s.c", pname, pname);
+	size_t slen = strlen(srchfor);
+	size_t ilen = strlen(swdeplist);
+	// read the file in, with enough extra space for the insert (ilen).
+	mdata  *amdat = getfile(ctx, "Makefile.am", ilen);
+	if (!amdat) return -1;
+	char *ip = memmem(amdat->fro, amdat->to - amdat->fro, srchfor,
+						slen);
+	if (!ip) {
+		free_mdata(amdat);
+		return seterr(ctx, "Could not find ???_SOURCES in Makefile.am.");
+	}
+	ip = memchr(ip, '\n', amdat->to - ip);
+	char *mvto = ip + ilen;
+	memmove(mvto, ip, amdat->to - ip);
+	memcpy(ip, swdeplist, ilen);
+	amdat->to += ilen;
+	return putmd(ctx, "Makefile.am", amdat, "w");
+} //updmakefile_am()
+
+char
+*swdepends(const char *optslist)
+{/* optslist may have software names in the form of xyz.h+c.
+  * Any such names will be expanded to xyz.h and xyz.c
+*/
+	if (!optslist) return NULL;
+
+	size_t olen = strlen(optslist);
+	if(!olen) return NULL;
+	size_t blen = 2*olen;
+	char *buf = xmalloc(blen);	// enough for every item xyz.h+c
+	buf[0] = 0;
+	char *list = xstrdup((char *)optslist);	// gets cut up.
+	char name[NAME_MAX];
+	char *wp, *we, *oe;
+	oe = list + olen;
+	wp = list;
+	while (wp < oe) {
+		while (*wp == ' ' || *wp == 0) wp++;
+		we = wp;
+		while (*we != ' ' && we < oe) we++;
+		*we = 0;
+		strcpy(name, wp);
+		char *splitp = strchr(name, '+');
+		if (splitp) {
+			*splitp = 0;
+			strjoin(buf, ' ', name, blen);
+			*(splitp-1) = *(splitp + 1);
+			*(splitp + 1) = 0;
+			strjoin(buf, ' ', name, blen);
+		} else strjoin(buf, ' ', name, blen);
+		wp = we;
+	}
+	free(list);
+	char *ret = xstrdup(buf);
+	free(buf);
+	return ret;
+} // swdepends()
+
+char
+*cfgpath(genctx_t *ctx, char *cfgid)
+{ /* Gets the parameter identified by cfgid from prdata.cfg, see
+   * getcfg(). NULL if there is none.
+*/
+	const char *cp = getcfg(cfgid);
+	if (!cp) {
+		seterr(ctx, "No such parameter in config: %s", cfgid);
+		return NULL;
+	}
+	return xstrdup((char *)cp);
+} // cfgpath()
+
+char
+*makefullpath(char *left, char *right)
+{/* Join them with '/' between and strdup() the result. */
+	char joinbuf[PATH_MAX];
+	const int max = PATH_MAX;
+	strcpy(joinbuf, getenv("HOME"));
+	strjoin(joinbuf, '/', left, max);
+	strjoin(joinbuf, '/', right, max);
+	return xstrdup(joinbuf);
+} // makefullpath()
+
+int
+linkorcopy(genctx_t *ctx, const char *stubdir, const char *compdir,
+			char *swdeplist)
+{ /* Checks the items in swdeplist to see if they exist in stubdir or
+   * compdir and brings each one found into the project dir, by the
+   * stublink or complink way set in prdata.cfg. Any filenames that
+   * exist in neither place will be warned about (stderr, non fatal).
+   * With --complib what ctx->libdir has comes from there, not compdir,
+   * so that the headers are those the library was built from.
+  */
+	if (!swdeplist) return 0;
+	int stubmode = getlinkmode(ctx, NULL, "stublink");
+	int compmode = getlinkmode(ctx, ctx->req->link_mode, "complink");
+	if (stubmode == -1 || compmode == -1) return -1;
+	/* A symlink into libdir does not count as a use of that version, see
+	 * storegc(), so what comes from there is never symlinked. */
+	int libmode = (compmode == LK_SYMLINK) ? LK_HARD : compmode;
+	char **depwords = list2array(swdeplist, ' ');
+	const char *dirs[] = {stubdir, ctx->libdir, compdir, NULL};
+	probedeps(depwords, dirs);
+	size_t index = 0;
+	size_t max = PATH_MAX;
+	int res = 0;
+	while (depwords[index] && res == 0) {
+		char joinbuf[PATH_MAX];
+		strcpy(joinbuf, stubdir);
+		strjoin(joinbuf, '/', depwords[index], max);
+		char libbuf[PATH_MAX] = "";
+		if (ctx->libdir[0]) {
+			strcpy(libbuf, ctx->libdir);
+			strjoin(libbuf, '/', depwords[index], max);
+		}
+		if (exists_file(joinbuf)) {
+			res = linkin(ctx, joinbuf, depwords[index], stubmode, 0);
+		} else if (libbuf[0] && exists_file(libbuf)) {
+			res = linkin(ctx, libbuf, depwords[index], libmode, 1);
+		} else { // not in stubdir
+			strcpy(joinbuf, compdir);
+			strjoin(joinbuf, '/', depwords[index], max);
+			if (exists_file(joinbuf)) {
+				res = linkin(ctx, joinbuf, depwords[index], compmode, 0);
+			} else { // not in compdir either
+				fprintf(stderr, "Software file unknown: %s\n",
+							depwords[index]);
+			}
+		}
+		index++;
+	} // while()
+	destroystrarray(depwords, 0);
+	return res;
+} // linkorcopy()
+
+int
+getcomplib(genctx_t *ctx, const char *stubdir, const char *compdir,
+			char **extras)
+{ /* With --complib, or complib=yes in prdata.cfg, find or build the
+   * libcomponents.a for compdir as it is, see complib(), and take the
+   * .c files that it has out of *extras. The project links with it
+   * rather than compiling them.
+  */
+	const char *cp = getcfg("complib");
+	if (!ctx->req->complib && !(cp && strcmp(cp, "yes") == 0)) return 0;
+	char *flags = cfgpath(ctx, "complibflags");
+	if (!flags) return -1;
+	ctx->libfd = complib(compdir, flags, ctx->libdir);
+	free(flags);
+	if (ctx->libfd == -1) {
+		ctx->libdir[0] = 0;
+		return seterrno(ctx, "Building libcomponents.a");
+	}
+	if (!*extras) return 0;
+	char **words = list2array(*extras, ' ');
+	const char *dirs[] = {stubdir, ctx->libdir, NULL};
+	probedeps(words, dirs);
+	mdata keep = {0};
+	size_t i;
+	for (i = 0; words[i]; i++) {
+		size_t len = strlen(words[i]);
+		char path[PATH_MAX];
+		int inlib = (len > 2 && strcmp(words[i] + len - 2, ".c") == 0);
+		if (inlib) {
+			strcpy(path, stubdir);
+			strjoin(path, '/', words[i], PATH_MAX);
+			inlib = !exists_file(path);	// stubdir comes first.
+		}
+		if (inlib) {
+			strcpy(path, ctx->libdir);
+			strjoin(path, '/', words[i], PATH_MAX);
+			inlib = exists_file(path);	// it compiled on its own.
+		}
+		if (!inlib) mdprintf(&keep, " %s", words[i]);
+	}
+	destroystrarray(words, 0);
+	free(*extras);
+	*extras = keep.fro;	// NULL if there is nothing left.
+	return 0;
+} // getcomplib()
+
+int
+getlinkmode(genctx_t *ctx, const char *mode, const char *cfgid)
+{ /* Index in linkmodes[] of mode, or if that is NULL of the cfgid value.
+   * -1 if not a mode.
+  */
+	if (!mode) mode = getcfg(cfgid);
+	if (!mode) return seterr(ctx, "No such parameter in config: %s", cfgid);
+	int i;
+	for (i = 0; linkmodes[i]; i++) {
+		if (strcmp(linkmodes[i], mode) == 0) return i;
+	}
+	return seterr(ctx, "No such link mode: %s, use hard, reflink, "
+					"symlink or copy.", mode);
+} // getlinkmode()
+
+int
+linkin(genctx_t *ctx, const char *src, const char *name, int mode,
+		int nosym)
+{ /* Put src into the project dir as name the way mode says. Failing
+   * that, because the filesystems differ or don't support it, each
+   * later way in linkmodes[] is tried, so that storage is still shared
+   * where it can be, skipping symlinks if nosym. Copying always works.
+  * For a tar stream src is read when the stream is written.
+  */
+	if (ctx->req->tar) {
+		tarlater(ctx, name, NULL, src, 0);
+		return 0;
+	}
+	struct stat sb;
+	if (ctx->req->update && fstatat(ctx->dirfd, name, &sb,
+									AT_SYMLINK_NOFOLLOW) == 0) {
+		return 0;
+	}
+	forgetin(ctx, name);
+	int m;
+	for (m = mode; m < LK_COPY; m++) {
+		if (m == LK_SYMLINK && nosym) continue;
+		int res;
+		char target[PATH_MAX];
+		if (m == LK_HARD) {
+			res = linkat(AT_FDCWD, src, ctx->dirfd, name, 0);
+		} else if (m == LK_REFLINK) {
+			res = reflink(src, inproject(ctx, target, name));
+		} else {
+			res = symlinkat(src, ctx->dirfd, name);
+		}
+		if (res == 0) break;
+		if (!cantshare(errno)) return seterrno(ctx, name);
+	}
+	if (m != mode && ctx->req->log) {
+		fprintf(ctx->req->log, "%s: %s in place of %s\n", name,
+					linkmodes[m], linkmodes[mode]);
+	}
+	if (m < LK_COPY) return 0;
+	mdata *md = slurp(ctx, AT_FDCWD, src, 0);
+	if (!md) return -1;
+	return putmd(ctx, name, md, "w");
+} // linkin()
+
+void
+probedeps(char **words, const char **dirs)
+{ /* Stat every dir/word at once, for the exists_file() calls that look
+   * for each word in dirs in turn to find in the cache. Empty dirs are
+   * skipped.
+  */
+	size_t nw, nd, n = 0;
+	for (nw = 0; words[nw]; nw++) ;
+	for (nd = 0; dirs[nd]; nd++) ;
+	char **paths = xmalloc((nw * nd + 1) * sizeof(char *));
+	size_t i, j;
+	for (i = 0; i < nw; i++) {
+		for (j = 0; j < nd; j++) {
+			if (!dirs[j][0]) continue;
+			char path[PATH_MAX];
+			strcpy(path, dirs[j]);
+			strjoin(path, '/', words[i], PATH_MAX);
+			paths[n++] = xstrdup(path);
+		}
+	}
+	paths[n] = NULL;
+	prefetchstats(paths, STATX_TYPE);
+	destroystrarray(paths, 0);
+} // probedeps()
+
+void
+forgetin(genctx_t *ctx, const char *name)
+{ /* forgetstat() for name in the project dir, which is about to change.
+   * The cache knows it by its full path, not as relative to ctx->dirfd.
+  */
+	char path[PATH_MAX];
+	forgetstat(AT_FDCWD, inproject(ctx, path, name));
+} // forgetin()
+
+const profile_t
+*getprofile(const char *name)
+{/* Look up the profile called name, NULL gets the default profile.
+  * Returns NULL for a name that is not a profile.
+*/
+	if (!name) return &profiles[0];
+	const profile_t *pp;
+	for (pp = profiles; pp->name; pp++) {
+		if (strcmp(pp->name, name) == 0) return pp;
+	}
+	return NULL;
+} // getprofile()
+
+char
+*stubname(const char *fn)
+{/* Name of the stub in the config dir that fn is made from, so that
+  * "sio.c" comes from "sioC", same as gopt.c and goptC.
+*/
+	char *ret = xstrdup((char *)fn);
+	char *dot = strrchr(ret, '.');
+	if (dot && dot[1]) {
+		dot[0] = toupper(dot[1]);
+		dot[1] = 0;
+	}
+	return ret;
+} // stubname()
+
+int
+extramakefile_am(genctx_t *ctx, const char *extraslist)
+{/* writes the extras list into the proper place in Makefile.am */
+	size_t xlen = strlen(extraslist);
+	mdata *md = getfile(ctx, "Makefile.am", 2 * xlen);	// to insert 2x
+	if (!md) return -1;
+	char *ip = memmem(md->fro, md->to - md->fro, "_DATA=",
+						strlen("_DATA="));
+	if (!ip) {
+		free_mdata(md);
+		return seterr(ctx, "Corrupted Makefile.am, no _DATA=");
+	}
+	ip = memchr(ip, '\n', md->to - ip);
+	char *moveto = ip + xlen;
+	memmove(moveto, ip, md->to - ip);
+	memcpy(ip, extraslist, xlen);
+	md->to += xlen;
+
+	ip = memmem(md->fro, md->to - md->fro, "EXTRA_DIST=",
+						strlen("EXTRA_DIST="));
+	if (!ip) {
+		free_mdata(md);
+		return seterr(ctx, "Corrupted Makefile.am, no EXTRA_DIST=");
+	}
+	ip = memchr(ip, '\n', md->to - ip);
+	moveto = ip + xlen;
+	memmove(moveto, ip, md->to - ip);
+	memcpy(ip, extraslist, xlen);
+	md->to += xlen;
+	return putmd(ctx, "Makefile.am", md, "w");
+} // extramakefile_am()
+
+int
+benchmakefile_am(genctx_t *ctx, char *benchstub, char *swdeplist)
+{/* Reads the stub for the benchmark rules, fills in the names recorded
+  * at pi-> and the software dependencies, which the harness links with,
+  * and appends them to Makefile.am. Automake distributes check_PROGRAMS
+  * sources itself so EXTRA_DIST needs nothing more.
+*/
+	iolist_t il = {0};
+	char *find[] = {"exe%s", "dep%s", NULL};
+	char *repl[] = {ctx->pi->exe, (swdeplist) ? swdeplist : ""};
+	renderstub(&il, benchstub, find, repl);
+	int res = putiov(ctx, "Makefile.am", &il, "a");
+	freeiol(&il);
+	return res;
+} // benchmakefile_am()
+
+int
+getbuildsystem(genctx_t *ctx, const char *name)
+{ /* Index in buildsystems[] of name, NULL being autotools. -1 if it is
+   * not one.
+  */
+	if (!name) return BS_AUTOTOOLS;
+	int i;
+	for (i = 0; buildsystems[i]; i++) {
+		if (strcmp(buildsystems[i], name) == 0) return i;
+	}
+	return seterr(ctx, "No such build system: %s, use autotools, make or "
+					"ninja.", name);
+} // getbuildsystem()
+
+int
+writebuildfile(genctx_t *ctx, int bs, const profile_t *prof, int hasopts,
+				char *extras)
+{/* Makefile or build.ninja in place of autotools, from the sources, man
+  * page and extra-dist files that Makefile.am would have had. Both
+  * track headers through the depfiles that gcc -MMD writes. addautotools()
+  * is not run, so there is only the man page to make besides.
+  */
+	progid *pi = ctx->pi;
+	const genreq_t *req = ctx->req;
+	const char *data = (req->extra_data) ? req->extra_data : "";
+	mdata srcs = {0};
+	mdprintf(&srcs, "%s%s%s%s%s%s", pi->src, (extras) ? extras : "",
+				(hasopts) ? " gopt.c gopt.h" : "",
+				(prof->srcfiles) ? " " : "",
+				(prof->srcfiles) ? prof->srcfiles : "",
+				(req->pch) ? " common.h" : "");
+	mdata edges = {0}, objs = {0}, inst = {0}, dist = {0};
+	int ninja = (bs == BS_NINJA);
+	// with --complib what is in the library links from there.
+	const char *lib = (ctx->libdir[0]) ? "libcomponents.a" : "";
+	if (ninja) {
+		ninjaedges(&edges, &objs, mdtext(&srcs), 1, req->pch);
+		if (lib[0]) mdprintf(&objs, " %s", lib);
+		if (data[0]) {
+			mdprintf(&inst, " && $\n    install -d $prefix/share/%s && $\n"
+						"    install -m 644 %s $prefix/share/%s/", pi->exe,
+						data, pi->exe);
+		}
+		// ninja can't add to the inputs of dist later, as make can.
+		mdprintf(&dist, "%s %s %s %s%s", mdtext(&srcs), pi->man, data, lib,
+					(req->with_bench) ? " bench/bench.c bench/bench.h" : "");
+	}
+	char *find[] = {"exe%s", "src%s", "man%s", "dat%s", "lda%s", "inst%s",
+					"edges%s", "objs%s", "dist%s", NULL};
+	char *repl[] = {pi->exe, mdtext(&srcs), pi->man, (char *)data,
+					(char *)lib, mdtext(&inst), mdtext(&edges),
+					mdtext(&objs), mdtext(&dist)};
+	iolist_t il = {0};
+	renderstub(&il, (ninja) ? "ninja.mak" : "plain.mak", find, repl);
+	int res = putiov(ctx, buildfiles[bs], &il, "w");
+	freeiol(&il);
+	if (res == 0 && req->with_bench) {
+		mdata bedges = {0}, bobjs = {0};
+		if (ninja) {
+			ninjaedges(&bedges, &bobjs, "bench/bench.c", 1, req->pch);
+			if (extras) ninjaedges(&bedges, &bobjs, extras, 0, 0);
+			if (lib[0]) mdprintf(&bobjs, " %s", lib);
+		}
+		char *bfind[] = {"dep%s", "edges%s", "objs%s", NULL};
+		char *brepl[] = {(extras) ? extras : "", mdtext(&bedges),
+						mdtext(&bobjs)};
+		res = addbuildstub(ctx, bs, "bench.mak", bfind, brepl);
+		keepout(ctx, bedges.fro);
+		keepout(ctx, bobjs.fro);
+	}
+	if (res == 0) res = addunitypch(ctx, bs, mdtext(&srcs));
+	if (res == 0) res = putfile(ctx, pi->man, NULL, NULL, "a");	// touch
+	// the build file is made of pieces of these.
+	keepout(ctx, srcs.fro);
+	keepout(ctx, edges.fro);
+	keepout(ctx, objs.fro);
+	keepout(ctx, inst.fro);
+	keepout(ctx, dist.fro);
+	return res;
+} // writebuildfile()
+
+void
+ninjaedges(mdata *edges, mdata *objs, const char *srcs, int withedges,
+			int pch)
+{/* Append the object of each .c in the space separated srcs to objs,
+  * and if withedges the build statement that compiles it to edges,
+  * which with pch waits for common.h.gch and starts from it.
+  */
+	const char *cp = srcs;
+	while (*cp) {
+		cp += strspn(cp, " ");
+		size_t len = strcspn(cp, " ");
+		if (len > 2 && strncmp(cp + len - 2, ".c", 2) == 0) {
+			int stem = (int)len - 2;
+			mdprintf(objs, (objs->to > objs->fro) ? " %.*s.o" : "%.*s.o",
+						stem, cp);
+			if (withedges) {
+				mdprintf(edges, "build %.*s.o: cc %.*s%s\n", stem, cp,
+							(int)len, cp, (pch) ? " | common.h.gch\n"
+							"  pch = -include common.h" : "");
+			}
+		}
+		cp += len;
+	}
+} // ninjaedges()
+
+int
+addbuildstub(genctx_t *ctx, int bs, const char *stub, char **find,
+				char **repl)
+{/* Render bs's own version of stub, plainpch.mak for make given pch.mak,
+  * and append it to what bs builds from.
+  */
+	char name[NAME_MAX];
+	snprintf(name, sizeof(name), "%s%s", buildstubs[bs], stub);
+	iolist_t il = {0};
+	renderstub(&il, name, find, repl);
+	int res = putiov(ctx, buildfiles[bs], &il, "a");
+	freeiol(&il);
+	return res;
+} // addbuildstub()
+
+int
+addunitypch(genctx_t *ctx, int bs, const char *srcs)
+{/* The unity target and the precompiled header if optioned, srcs being
+  * what ninja must list for the unity source. The pch rules go last so
+  * that for make every list of objects they add to has been seen.
+  */
+	const genreq_t *req = ctx->req;
+	char *exe = ctx->pi->exe;
+	int res = 0;
+	if (req->unity) {
+		mdata edges = {0}, objs = {0};
+		if (bs == BS_NINJA) {
+			char unity[NAME_MAX];
+			snprintf(unity, sizeof(unity), "%s-unity.c", exe);
+			ninjaedges(&edges, &objs, unity, 1, req->pch);
+		}
+		char *find[] = {"exe%s", "src%s", "edges%s", NULL};
+		char *repl[] = {exe, (char *)srcs, mdtext(&edges)};
+		res = addbuildstub(ctx, bs, "unity.mak", find, repl);
+		keepout(ctx, edges.fro);
+		free(objs.fro);
+	}
+	if (res == 0 && req->pch) {
+		char *find[] = {"exe%s", NULL};
+		char *repl[] = {exe};
+		res = addbuildstub(ctx, bs, "pch.mak", find, repl);
+	}
+	return res;
+} // addunitypch()
+
+int
+genbench(genctx_t *ctx)
+{/* Make bench/ and put the harness stubs in it. */
+	forgetin(ctx, "bench");
+	if (ctx->dirfd != -1 && mkdirat(ctx->dirfd, "bench", 0775) == -1
+			&& errno != EEXIST) {
+		return seterrno(ctx, "bench");
+	}
+	if (putstub(ctx, "benchC", "bench/bench.c") == -1) return -1;
+	markseed(ctx, "bench/bench.c");
+	return putstub(ctx, "benchH", "bench/bench.h");
+} // genbench()
+
+int
+gensrcfiles(genctx_t *ctx, const profile_t *prof, char *oplist,
+				int hasopts)
+{/* Generate the C program pi->src from the stub named by prof, along
+  * with any other sources that profile has, and if hasopts has been set
+  * generate the gopt.c and gopt.h files. If oplist is NULL and there is
+  * no --options-file quit, else call genoptions(). With --fast-options
+  * gopt.c comes from the stub that does not use getopt_long().
+*/
+	if (putstub(ctx, prof->mainstub, ctx->pi->src) == -1) return -1;
+	markseed(ctx, ctx->pi->src);
+	if (prof->srcfiles) {
+		char **srcs = list2array(prof->srcfiles, ' ');
+		size_t i;
+		int res = 0;
+		for (i = 0; srcs[i] && res == 0; i++) {
+			char *stub = stubname(srcs[i]);
+			res = putstub(ctx, stub, srcs[i]);
+			free(stub);
+		}
+		destroystrarray(srcs, 0);
+		if (res == -1) return -1;
+	}
+	if (!hasopts) return 0;
+	// else make gopt.[h|c]
+	int fast = ctx->req->fast_options;
+	if (putstub(ctx, (fast) ? "fgoptC" : "goptC", "gopt.c") == -1) {
+		return -1;
+	}
+	if (putstub(ctx, "goptH", "gopt.h") == -1) return -1;
+	if (oplist || ctx->req->options_file) {
+		return genoptions(ctx, oplist);
+	}
+	/* If the gopt source files got made they will contain many comments
+	 * with the word 'target' in them. Likely useful if writing in
+	 * options processing by hand. If genoptions() is run those comments
+	 * will have been obliterated.
+	*/
+	return 0;
+} // gensrcfiles()
+
+int
+genoptions(genctx_t *ctx, char *optionslst)
+{	/* Using comments with the word 'target' in them, insert options
+	 * processing code into the files, gopt.[c|h] and pi->src. The
+	 * options come from optionslst and then --options-file.
+	*/
+	int res = 0;
+	if (optionslst) res = words2ol(ctx, optionslst);
+	if (res == 0 && ctx->req->options_file) {
+		res = readoptfile(ctx, ctx->req->options_file);
+	}
+	if (res == 0) res = checkopts(ctx);
+	oplist_t **ol = ctx->ol;
+	// Deal with 3 files that have been already saved in project dir.
+	if (res == 0) res = updatemainfile(ctx, ctx->pi->src, ol);
+	if (res == 0) res = updategoptHfile(ctx, "gopt.h", ol);
+	if (res == 0) {
+		if (ctx->req->fast_options) {
+			res = updatefgoptCfile(ctx, "gopt.c", ol);
+		} else {
+			res = updategoptCfile(ctx, "gopt.c", ol);
+		}
+	}
+	freeol(ctx);
+	freetargets(ctx);
+	return res;
+} // genoptions()
+
+int
+words2ol(genctx_t *ctx, char *listofopts)
+{/* From a list of words (coded as options data) add to the list of
+  * oplist_t structs.
+*/
+	char *words = xstrdup(listofopts);
+	char *save;
+	char *w;
+	int res = 0;
+	for (w = strtok_r(words, " ", &save); w && res == 0;
+			w = strtok_r(NULL, " ", &save)) {
+		res = addopt(ctx, w, NULL, NULL, 0);
+	}
+	free(words);
+	return res;
+} // words2ol()
+
+int
+readoptfile(genctx_t *ctx, const char *path)
+{ /* Add the options in path, read a line at a time. Each line is an
+   * option code as for --options-list, optionally followed by the help
+   * text for it. Blank lines and lines starting with '#' are skipped.
+  */
+	FILE *fp = fopen(path, "re");
+	if (!fp) return seterrno(ctx, path);
+	char *line = NULL;
+	size_t cap = 0;
+	size_t lineno = 0;
+	int res = 0;
+	while (res == 0 && getline(&line, &cap, fp) != -1) {
+		lineno++;
+		char *cp = line;
+		while (isspace((unsigned char)*cp)) cp++;
+		if (!*cp || *cp == '#') continue;
+		char *code = cp;
+		while (*cp && !isspace((unsigned char)*cp)) cp++;
+		if (*cp) *cp++ = 0;
+		while (isspace((unsigned char)*cp)) cp++;
+		char *end = cp + strlen(cp);
+		while (end > cp && isspace((unsigned char)end[-1])) *--end = 0;
+		res = addopt(ctx, code, (*cp) ? cp : NULL, path, lineno);
+	}
+	if (res == 0 && ferror(fp)) res = seterrno(ctx, path);
+	free(line);
+	fclose(fp);
+	return res;
+} // readoptfile()
+
+int
+addopt(genctx_t *ctx, char *code, const char *help, const char *from,
+		size_t lineno)
+{ /* Add the option that code describes, eg "ooutput:". A short name of
+   * '-' makes it long only, "-max-depth:" for example. from and lineno
+   * say where code came from for errors, from is NULL for the list.
+  */
+	char *colon = strchr(code + 1, ':');
+	size_t llen = (colon) ? (size_t)(colon - code - 1) : strlen(code + 1);
+	int ok = (isalnum((unsigned char)code[0]) || code[0] == '-');
+	ok = ok && llen && llen < NAME_MAX / 2;
+	size_t i;
+	for (i = 1; ok && i <= llen; i++) {
+		ok = (isalnum((unsigned char)code[i]) || code[i] == '-' ||
+				code[i] == '_');
+	}
+	if (!ok) {
+		if (from) {
+			return seterr(ctx, "%s:%zu: Not an option code: %s", from,
+							lineno, code);
+		}
+		return seterr(ctx, "Not an option code: %s", code);
+	}
+	if (ctx->nol + 1 >= ctx->olcap) {	// room for the NULL at the end.
+		ctx->olcap = (ctx->olcap) ? 2 * ctx->olcap : 64;
+		ctx->ol = realloc(ctx->ol, ctx->olcap * sizeof(oplist_t *));
+		if (!ctx->ol) {
+			fputs("Out of memory.\n", stderr);
+			exit(EXIT_FAILURE);
+		}
+	}
+	oplist_t *tmp = xmalloc(sizeof(oplist_t));
+	tmp->optarg = (colon) ? ((colon[1] == ':') ? 2 : 1) : 0;
+	tmp->longoptname = xmalloc(llen + 1);
+	memcpy(tmp->longoptname, code + 1, llen);
+	tmp->longoptname[llen] = 0;
+	char buf[NAME_MAX];
+	if (code[0] == '-') {	// long only, getopt_long() returns > 255.
+		buf[0] = 0;
+		tmp->val = 256 + ctx->nol;
+	} else {
+		buf[0] = code[0];
+		buf[1] = 0;
+		strncat(buf, "::", tmp->optarg);
+		tmp->val = code[0];
+	}
+	tmp->shoptname = xstrdup(buf);
+	if (tmp->val > 255) {
+		sprintf(buf, "o_%s", tmp->longoptname);
+		char *cp;
+		for (cp = buf; *cp; cp++) if (*cp == '-') *cp = '_';
+	} else {
+		sprintf(buf, "o_%c", code[0]);
+	}
+	tmp->field = xstrdup(buf);
+	sprintf(buf, "opts.%s", tmp->field);
+	tmp->dataname = xstrdup(buf);
+	tmp->help = (help) ? xstrdup((char *)help) : NULL;
+	ctx->ol[ctx->nol++] = tmp;
+	ctx->ol[ctx->nol] = NULL;
+	return 0;
+} // addopt()
+
+int
+checkopts(genctx_t *ctx)
+{ /* Names that clash would make code that does not compile, or worse.
+   * Sorting finds them in n log n, as there may be thousands.
+  */
+	size_t n = ctx->nol, i;
+	unsigned char seen[256] = {0};
+	seen['h'] = 1;	// --help
+	for (i = 0; i < n; i++) {
+		int v = ctx->ol[i]->val;
+		if (v > 255) continue;
+		if (seen[v]) return seterr(ctx, "Duplicate short option: -%c", v);
+		seen[v] = 1;
+	}
+	char **names = xmalloc((n + 1) * sizeof(char *));
+	names[0] = "help";
+	for (i = 0; i < n; i++) names[i + 1] = ctx->ol[i]->longoptname;
+	qsort(names, n + 1, sizeof(char *), cmpstrp);
+	for (i = 1; i <= n; i++) {
+		if (strcmp(names[i - 1], names[i]) == 0) {
+			seterr(ctx, "Duplicate long option: --%s", names[i]);
+			free(names);
+			return -1;
+		}
+	}
+	for (i = 0; i < n; i++) names[i] = ctx->ol[i]->field;
+	qsort(names, n, sizeof(char *), cmpstrp);
+	for (i = 1; i < n; i++) {
+		if (strcmp(names[i - 1], names[i]) == 0) {
+			seterr(ctx, "Two options would both be opts.%s", names[i]);
+			free(names);
+			return -1;
+		}
+	}
+	free(names);
+	return 0;
+} // checkopts()
+
+int
+cmpstrp(const void *a, const void *b)
+{ /* qsort() comparison for an array of char *. */
+	return strcmp(*(char * const *)a, *(char * const *)b);
+} // cmpstrp()
+
+void
+freeol(genctx_t *ctx)
+{
+	size_t i;
+	for (i = 0; i < ctx->nol; i++) {
+		oplist_t *os = ctx->ol[i];
+		free(os->help);	// may be NULL, which would end vfree().
+		vfree(os->shoptname, os->longoptname, os->dataname, os->field,
+				os, NULL);
+	}
+	free(ctx->ol);
+	ctx->ol = NULL;
+	ctx->nol = ctx->olcap = 0;
+} // freeol()
+
+char
+*optnames(char *buf, const oplist_t *os)
+{ /* "-o, --output" or for a long only option "--output". */
+	if (os->val > 255) {
+		sprintf(buf, "--%s", os->longoptname);
+	} else {
+		sprintf(buf, "-%c, --%s", os->val, os->longoptname);
+	}
+	return buf;
+} // optnames()
+
+char
+*caselabel(char *buf, const oplist_t *os)
+{ /* What getopt_long() returns for os, as C. */
+	if (os->val > 255) {
+		sprintf(buf, "%d", os->val);
+	} else {
+		sprintf(buf, "'%c'", os->val);
+	}
+	return buf;
+} // caselabel()
+
+char
+*mdroom(mdata *md, size_t len)
+{ /* Make room for len more bytes and a '\0' at md->to, doubling the
+   * size each time so that building up a target of any length costs
+   * time in proportion to it. md may start out all NULL.
+  */
+	size_t have = md->to - md->fro;
+	size_t cap = md->limit - md->fro;
+	if (have + len + 1 > cap) {
+		if (!cap) cap = 256;
+		while (have + len + 1 > cap) cap *= 2;
+		char *p = realloc(md->fro, cap);
+		if (!p) {
+			fputs("Out of memory.\n", stderr);
+			exit(EXIT_FAILURE);
+		}
+		md->fro = p;
+		md->to = p + have;
+		md->limit = p + cap;
+	}
+	return md->to;
+} // mdroom()
+
+void
+mdprintf(mdata *md, const char *fmt, ...)
+{ /* Append to md as printf() would, md->to is left on the '\0'. */
+	va_list ap;
+	va_start(ap, fmt);
+	int len = vsnprintf(NULL, 0, fmt, ap);
+	va_end(ap);
+	char *p = mdroom(md, len);
+	va_start(ap, fmt);
+	vsnprintf(p, len + 1, fmt, ap);
+	va_end(ap);
+	md->to += len;
+} // mdprintf()
+
+void
+mdcstr(mdata *md, const char *s)
+{ /* Append s escaped to go inside a C string literal. */
+	for ( ; *s; s++) {
+		char *p = mdroom(md, 2);
+		switch (*s) {
+		case '"':
+		case '\\':
+			*p++ = '\\';
+			*p++ = *s;
+			break;
+		case '\t':
+			*p++ = '\\';
+			*p++ = 't';
+			break;
+		default:
+			*p++ = *s;
+			break;
+		}
+		*p = 0;
+		md->to = p;
+	}
+} // mdcstr()
+
+char
+*mdtext(mdata *md)
+{ /* What has been put in md, "" if nothing has. */
+	return (md->fro) ? md->fro : "";
+} // mdtext()
+
+void
+freetargets(genctx_t *ctx)
+{
+	mdata *mds[] = { &ctx->bufso, &ctx->buflo, &ctx->bufop, &ctx->bufhl,
+					&ctx->bufsy, &ctx->buffo, &ctx->bufsm, &ctx->bufph };
+	size_t i;
+	for (i = 0; i < sizeof(mds) / sizeof(mds[0]); i++) {
+		keepout(ctx, mds[i]->fro);	// gopt.c is made of pieces of them.
+		memset(mds[i], 0, sizeof(mdata));
+	}
+} // freetargets()
+
+int
+updatemainfile(genctx_t *ctx, const char *fn, oplist_t **ol)
+{/* The job here is to generate a set of print statements to show
+  * what options have been chosen. And it creates a place holder to go
+  * to write the code really required when choosing those options.
+ */
+	mdata *md = getfile(ctx, fn, 1024);
+	if (!md) return -1;
+	mdata code = {0};
+	size_t idx;
+	for (idx = 0; ol[idx]; idx++) {
+		oplist_t *tmp = ol[idx];
+		char *fmt;
+		fmt = (tmp->optarg == 0) ? "%d" : "%s";
+		char names[NAME_MAX];
+		mdprintf(&code, "\tif (%s) printf(\"%s%c%c\", %s);\t// %s\n",
+				tmp->dataname, fmt, '\\', 'n', tmp->dataname,
+				optnames(names, tmp));
+	}
+	memreplace(md, "/* dummy opts target */", mdtext(&code), 1024);
+	free(code.fro);
+	return putmd(ctx, fn, md, "w");
+} // updatemainfile()
+
+int
+updategoptHfile(genctx_t *ctx, const char *fn, oplist_t **ol)
+{/* define the variables used in the options_t struct. */
+	mdata *md = getfile(ctx, fn, 128);
+	if (!md) return -1;
+	mdata code = {0};
+	size_t idx;
+	for (idx = 0; ol[idx]; idx++) {
+		oplist_t *tmp = ol[idx];
+		char *vartype = (tmp->optarg == 0) ? "int\t " : "char\t*";
+		char names[NAME_MAX];
+		mdprintf(&code, "\t%s%s;\t// %s\n", vartype, tmp->field,
+					optnames(names, tmp));
+	}
+	memreplace(md, "/* header target */", mdtext(&code), 256);
+	free(code.fro);
+	return putmd(ctx, fn, md, "w");
+} // updategoptHfile()
+
+int
+updategoptCfile(genctx_t *ctx, const char *fn, oplist_t **ol)
+{
+	mdata *md = getfile(ctx, fn, 0);
+	if (!md) return -1;
+	size_t idx;
+	for (idx = 0; ol[idx]; idx++) {
+		oplist_t *tmp = ol[idx];
+		sotarget(ctx, tmp);
+		lotarget(ctx, tmp);
+		optarget(ctx, tmp);
+		hltarget(ctx, tmp);
+	} // for()
+	sytarget(ctx);
+	char *find[] = {"/* short options target */",
+		"/* long options target */\n", "/* option proc target */\n",
+		"/* help target */\n", "/* syn target */\n", NULL};
+	char *repl[] = {mdtext(&ctx->bufso), mdtext(&ctx->buflo),
+		mdtext(&ctx->bufop), mdtext(&ctx->bufhl), mdtext(&ctx->bufsy)};
+	iolist_t il = {0};
+	renderiov(&il, md->fro, md->to, find, repl);
+	int res = putiov(ctx, fn, &il, "w");
+	freeiol(&il);
+	keepmd(ctx, md);
+	return res;
+} // updategoptCfile()
+
+int
+updatefgoptCfile(genctx_t *ctx, const char *fn, oplist_t **ol)
+{/* As updategoptCfile() but for the stub that uses lookup tables in
+  * place of getopt_long().
+*/
+	mdata *md = getfile(ctx, fn, 0);
+	if (!md) return -1;
+	size_t idx;
+	for (idx = 0; ol[idx]; idx++) {
+		oplist_t *tmp = ol[idx];
+		fotarget(ctx, tmp, idx);
+		hltarget(ctx, tmp);
+	} // for()
+	if (phtarget(ctx, ol) == -1) {
+		free_mdata(md);
+		return -1;
+	}
+	sytarget(ctx);
+	char *find[] = {"/* fast options target */\n",
+		"/* short map target */\n", "/* perfect hash target */\n",
+		"/* help target */\n", "/* syn target */\n", NULL};
+	char *repl[] = {mdtext(&ctx->buffo), mdtext(&ctx->bufsm),
+		mdtext(&ctx->bufph), mdtext(&ctx->bufhl), mdtext(&ctx->bufsy)};
+	iolist_t il = {0};
+	renderiov(&il, md->fro, md->to, find, repl);
+	int res = putiov(ctx, fn, &il, "w");
+	freeiol(&il);
+	keepmd(ctx, md);
+	return res;
+} // updatefgoptCfile()
+
+void
+sotarget(genctx_t *ctx, oplist_t *os)
+{ /* Short option */
+	mdprintf(&ctx->bufso, "%s", os->shoptname);
+} // sotarget()
+
+void
+lotarget(genctx_t *ctx, oplist_t *os)
+{ /* Long option */
+	char label[16];
+	mdprintf(&ctx->buflo, "\t\t{\"%s\",\t%d,\t0,\t%s},\n",
+			os->longoptname, os->optarg, caselabel(label, os));
+} // lotarget()
+
+void
+optarget(genctx_t *ctx, oplist_t *os)
+{ /* Option processing */
+	char *vfmt[] = { "%s = 1", "%s = xstrdup(optarg)",
+					"if (optarg) %s = xstrdup(optarg)" };
+	char label[16];
+	mdprintf(&ctx->bufop, "\t\tcase %s:\n\t\t\t", caselabel(label, os));
+	mdprintf(&ctx->bufop, vfmt[os->optarg], os->dataname);
+	mdprintf(&ctx->bufop, ";\n\t\t\tbreak;\n");
+} // optarget()
+
+void
+hltarget(genctx_t *ctx, oplist_t *os)
+{ /* help processing, the text from --options-file if there is any. */
+	char *vchar[] = { "", "options_argument",
+						"(optional) options_argument"};
+	char names[NAME_MAX];
+	mdprintf(&ctx->bufhl, "  \"\\t%s %s\\n\"\n", optnames(names, os),
+				vchar[os->optarg]);
+	if (os->help) {
+		mdprintf(&ctx->bufhl, "  \"\\t");
+		mdcstr(&ctx->bufhl, os->help);
+		mdprintf(&ctx->bufhl, "\\n\\n\"\n");
+		return;
+	}
+	char *vfmt[] = {"Sets %s to 1, the default is 0.\\n\\n",
+					"Copies optarg to %s, default is NULL.\\n\\n",
+					"If optarg is provided, copies it to %s,"
+					" default value is NULL.\\n\\n"};
+	mdprintf(&ctx->bufhl, "  \"\\t");
+	mdprintf(&ctx->bufhl, vfmt[os->optarg], os->dataname);
+	mdprintf(&ctx->bufhl, "\"\n");
+} // hltarget()
+
+void
+sytarget(genctx_t *ctx)
+{ /* synopsis and description */
+	mdprintf(&ctx->bufsy, "  \"\\t\\t%s [option] program_name\\n\\n\"\n",
+				ctx->req->name);
+	mdprintf(&ctx->bufsy, "  \"\\tDESCRIPTION\\n\"\n"
+	"  \"\\tMake necessary explanation of the"
+	" purpose and features of the program.\"\n"
+		);
+} // sytarget()
+
+void
+fotarget(genctx_t *ctx, oplist_t *os, size_t idx)
+{ /* Option descriptor and short option dispatch entry. Index 0 of the
+   * descriptors is --help so this option lives at idx + 1, and the
+   * dispatch table holds index + 1 so that 0 can mean unknown.
+  */
+	char label[16];
+	mdprintf(&ctx->buffo, "\t{\"%s\",\t%s,\t%d,\toffsetof(options_t, %s)},\n",
+			os->longoptname, (os->val > 255) ? "0" : caselabel(label, os),
+			os->optarg, os->field);
+	if (os->val > 255) return;	// long only.
+	mdprintf(&ctx->bufsm, "\t['%c'] = %lu,\n", os->val, idx + 2);
+} // fotarget()
+
+int
+phtarget(genctx_t *ctx, oplist_t **ol)
+{ /* Build a perfect hash over the long option names, --help included,
+   * by hash and displace. The names go in buckets by their hash and
+   * each bucket, fullest first, gets the displacement that sends all
+   * of its names to free slots. That takes close to linear time, where
+   * looking for one seed that suits every name at once does not, so
+   * thousands of options are no trouble. Then write out the seed,
+   * masks and tables for findlong() in the fgoptC stub.
+  */
+	size_t n, i;
+	for (n = 0; ol[n]; n++);
+	n++;	// --help
+	if (n > SHRT_MAX) {
+		return seterr(ctx, "%zu options are too many for --fast-options",
+						n);
+	}
+	char **names = xmalloc(n * sizeof(char *));
+	names[0] = "help";
+	for (i = 1; i < n; i++) names[i] = ol[i-1]->longoptname;
+	unsigned *hash = xmalloc(n * sizeof(unsigned));
+	unsigned nb = 1;
+	while (nb < n / 2) nb *= 2;
+	unsigned size = 8;
+	while (size < 2 * n) size *= 2;
+	unsigned short *disp = NULL;
+	short *table = NULL;
+	unsigned seed;
+	for (seed = 0; ; seed++) {
+		for (i = 0; i < n; i++) {
+			hash[i] = phash(names[i], strlen(names[i]), seed);
+		}
+		disp = realloc(disp, nb * sizeof(unsigned short));
+		table = realloc(table, size * sizeof(short));
+		if (!disp || !table) {
+			fputs("Out of memory.\n", stderr);
+			exit(EXIT_FAILURE);
+		}
+		if (phplace(hash, n, nb, size, disp, table) == 0) break;
+		if (seed % 8 == 7) size *= 2;	// too crowded, spread them out.
+	}
+	mdata *md = &ctx->bufph;
+	mdprintf(md, "#define PH_SEED %uu\n#define PH_BMASK %uu\n"
+			"#define PH_MASK %uu\n\n", seed, nb - 1, size - 1);
+	mdprintf(md, "static const unsigned short phdisp[%u] = {\n", nb);
+	for (i = 0; i < nb; i++) {
+		mdprintf(md, "%s%u,%s", (i % 8) ? " " : "\t", disp[i],
+					(i % 8 == 7 || i == nb - 1) ? "\n" : "");
+	}
+	mdprintf(md, "};\n\nstatic const short phtable[%u] = {\n", size);
+	for (i = 0; i < size; i++) {
+		mdprintf(md, "%s%d,%s", (i % 8) ? " " : "\t", table[i],
+					(i % 8 == 7) ? "\n" : "");
+	}
+	mdprintf(md, "};\n");
+	vfree(table, disp, hash, names, NULL);
+	return 0;
+} // phtarget()
+
+int
+phplace(const unsigned *hash, size_t n, unsigned nb, unsigned size,
+		unsigned short *disp, short *table)
+{ /* Fill disp[nb] and table[size] for the n hashes, 0 if that could
+   * be done, -1 if some bucket would not fit.
+  */
+	size_t *start = xmalloc((nb + 1) * sizeof(size_t));
+	size_t *order = xmalloc(n * sizeof(size_t));
+	memset(start, 0, (nb + 1) * sizeof(size_t));
+	size_t i, maxc = 0;
+	for (i = 0; i < n; i++) start[(hash[i] & (nb - 1)) + 1]++;
+	unsigned b;
+	for (b = 0; b < nb; b++) {
+		if (start[b + 1] > maxc) maxc = start[b + 1];
+		start[b + 1] += start[b];
+	}
+	size_t *fill = xmalloc(nb * sizeof(size_t));
+	memcpy(fill, start, nb * sizeof(size_t));
+	for (i = 0; i < n; i++) order[fill[hash[i] & (nb - 1)]++] = i;
+	memset(disp, 0, nb * sizeof(unsigned short));
+	memset(table, -1, size * sizeof(short));
+	int res = 0;
+	size_t sz;
+	for (sz = maxc; sz && res == 0; sz--) {	// fullest buckets first.
+		for (b = 0; b < nb && res == 0; b++) {
+			if (start[b + 1] - start[b] != sz) continue;
+			unsigned d;
+			for (d = 0; d <= USHRT_MAX; d++) {
+				size_t k;
+				for (k = start[b]; k < start[b + 1]; k++) {
+					unsigned s = phmix(hash[order[k]] ^ d) & (size - 1);
+					if (table[s] != -1) break;
+					table[s] = order[k];
+				}
+				if (k == start[b + 1]) break;	// all in.
+				while (k-- > start[b]) {	// undo, try the next d.
+					table[phmix(hash[order[k]] ^ d) & (size - 1)] = -1;
+				}
+			}
+			if (d > USHRT_MAX) res = -1;
+			disp[b] = d;
+		}
+	}
+	vfree(fill, order, start, NULL);
+	return res;
+} // phplace()
+
+unsigned
+phash(const char *s, size_t len, unsigned seed)
+{ /* Seeded FNV-1a, must match phash() in the fgoptC stub. */
+	unsigned h = 2166136261u ^ seed;
+	size_t i;
+	for (i = 0; i < len; i++) {
+		h ^= (unsigned char)s[i];
+		h *= 16777619u;
+	}
+	return h;
+} // phash()
+
+unsigned
+phmix(unsigned h)
+{ /* Spread the bits of h, must match phmix() in the fgoptC stub. */
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	h *= 0x846ca68bu;
+	h ^= h >> 16;
+	return h;
+} // phmix()
+
+int
+addautotools(genctx_t *ctx, const profile_t *prof)
+{/* adds files needed by autotools, runs programs and amends files
+  * as required. NB `automake --add-missing --copy` no longer makes
+  * copies of some files required by a GNU standard build so I create
+  * them here.
+  */
+	progid *pi = ctx->pi;
+	char *author = cfgpath(ctx, "author");
+	if (!author) return -1;
+	char *email = cfgpath(ctx, "email");
+	if (!email) {
+		free(author);
+		return -1;
+	}
+	// Create files required.
+	char joinbuf[NAME_MAX];
+	int res = 0;
+	sprintf(joinbuf, "README for %s", pi->exe);
+	res |= putstr(ctx, "README", joinbuf);
+	sprintf(joinbuf, "NOTES for %s", pi->exe);
+	res |= putstr(ctx, "NOTES", joinbuf);
+	sprintf(joinbuf, "ChangeLog for %s", pi->exe);
+	res |= putstr(ctx, "ChangeLog", joinbuf);
+	sprintf(joinbuf, "NEWS for %s", pi->exe);
+	res |= putstr(ctx, "NEWS", joinbuf);
+	sprintf(joinbuf, "Author for %s", pi->exe);
+	strjoin(joinbuf, '\n', author, NAME_MAX);
+	strjoin(joinbuf, ' ', email, NAME_MAX);
+	res |= putstr(ctx, "AUTHORS", joinbuf);
+	// run the autotools stuff, of an existing configure.ac only the
+	// checks are remade.
+	if (res == 0) res = writeconfigure_ac(ctx, prof, email);
+	if (res == 0) res = flushout(ctx);
+	// Each tool with what it makes and what that is made from.
+	static const char *acin[] = { "configure.ac", NULL };
+	static const char *m4in[] = { "configure.ac", "aclocal.m4", NULL };
+	static const char *amin[] = { "configure.ac", "aclocal.m4",
+									"Makefile.am", NULL };
+	static const struct {
+		const char *cmd;
+		const char *out;
+		const char **ins;
+	} tools[] = {
+		{ "aclocal", "aclocal.m4", acin },
+		{ "autoheader", "config.h.in", m4in },
+		{ "automake --add-missing --copy", "Makefile.in", amin },
+		{ "autoconf", "configure", m4in },
+		{ NULL, NULL, NULL }
+	};
+	int i;
+	for (i = 0; tools[i].cmd && res == 0; i++) {
+		if (!needtool(ctx, tools[i].out, tools[i].ins)) continue;
+		res = runtool(ctx, tools[i].cmd);
+		// A tool may leave its output alone if nothing changed.
+		if (res == 0) utimensat(ctx->dirfd, tools[i].out, NULL, 0);
+	}
+	if (res == 0) res = putfile(ctx, pi->man, NULL, NULL, "a");	// touch
+	vfree(email, author, NULL);
+	return res;
+} // addautotools()
+
+int
+writeconfigure_ac(genctx_t *ctx, const profile_t *prof, const char *email)
+{/* Renders configure.ac from the configureAC stub with the checks that
+  * acchecks.cfg lists for the sources in Makefile.am, which is what
+  * autoscan used to be run for. Sources it has nothing for, the user's
+  * own components say, add nothing.
+  */
+	progid *pi = ctx->pi;
+	mdata *am = getfile(ctx, "Makefile.am", 0);
+	if (!am) return -1;
+	// the stems of every file named in a _SOURCES= line.
+	size_t nstem = 0;
+	char **stems = xmalloc((am->to - am->fro + 1) * sizeof(char *));
+	stems[0] = NULL;
+	char *cp = am->fro;
+	while ((cp = strstr(cp, "_SOURCES=")) != NULL) {
+		cp += strlen("_SOURCES=");
+		char *eol = strchr(cp, '\n');
+		if (!eol) eol = am->to;
+		while (cp < eol) {
+			cp += strspn(cp, " \t");
+			size_t len = strcspn(cp, " \t\n");
+			if (!len) break;
+			char *stem = acstem(ctx, prof, cp, len);
+			if (stem && !instrlist(stem, stems)) {
+				stems[nstem++] = stem;
+				stems[nstem] = NULL;
+			} else {
+				free(stem);
+			}
+			cp += len;
+		}
+	}
+	free_mdata(am);
+	// the checks they need, macros of the AC_FUNC_ kind go with the
+	// functions, any other macros with the types.
+	enum { AC_HDR, AC_FUN, AC_TYP, AC_FUNCMACRO, AC_KINDS };
+	mdata *tab = getstub("acchecks.cfg");
+	size_t most = (tab->to - tab->fro) / 2 + 1;
+	char **items[AC_KINDS];
+	size_t nitem[AC_KINDS] = {0};
+	int k;
+	for (k = 0; k < AC_KINDS; k++) items[k] = xmalloc(most * sizeof(char *));
+	char *lsave, *line;
+	for (line = strtok_r(tab->fro, "\n", &lsave); line;
+			line = strtok_r(NULL, "\n", &lsave)) {
+		if (line[0] == '#') continue;
+		char *wsave;
+		char *stem = strtok_r(line, " \t", &wsave);
+		char *kind = strtok_r(NULL, " \t", &wsave);
+		if (!stem || !kind || !instrlist(stem, stems)) continue;
+		char *item;
+		while ((item = strtok_r(NULL, " \t", &wsave)) != NULL) {
+			if (strcmp(kind, "headers") == 0) {
+				k = AC_HDR;
+			} else if (strcmp(kind, "functions") == 0) {
+				k = AC_FUN;
+			} else if (strncmp(item, "AC_FUNC_", 8) == 0) {
+				k = AC_FUNCMACRO;
+			} else {
+				k = AC_TYP;
+			}
+			items[k][nitem[k]++] = item;
+		}
+	}
+	mdata hdr = {0}, typ = {0}, fun = {0};
+	acjoin(&hdr, "AC_CHECK_HEADERS", items[AC_HDR], nitem[AC_HDR]);
+	acjoin(&typ, NULL, items[AC_TYP], nitem[AC_TYP]);
+	acjoin(&fun, NULL, items[AC_FUNCMACRO], nitem[AC_FUNCMACRO]);
+	acjoin(&fun, "AC_CHECK_FUNCS", items[AC_FUN], nitem[AC_FUN]);
+	char *find[] = {"exe%s", "bug%s", "src%s", "hdr%s", "typ%s", "fun%s",
+					NULL};
+	char *repl[] = {pi->exe, (char *)email, pi->src, mdtext(&hdr),
+					mdtext(&typ), mdtext(&fun)};
+	iolist_t il = {0};
+	renderstub(&il, "configureAC", find, repl);
+	int res;
+	if (ctx->req->update && exists_fileat(ctx->dirfd, "configure.ac")) {
+		res = updconfigure_ac(ctx, &il);
+	} else {
+		res = putiov(ctx, "configure.ac", &il, "w");
+	}
+	freeiol(&il);
+	keepout(ctx, hdr.fro);
+	keepout(ctx, typ.fro);
+	keepout(ctx, fun.fro);
+	for (k = 0; k < AC_KINDS; k++) free(items[k]);
+	free_mdata(tab);
+	destroystrarray(stems, nstem);
+	return res;
+} // writeconfigure_ac()
+
+int
+updconfigure_ac(genctx_t *ctx, iolist_t *il)
+{/* configure.ac is the user's, so for --update put only the checks
+  * between the markers in il in place of those in the one there is.
+  * Without markers, made by an older newprogram or taken out, it is
+  * left alone and the user told the checks have not been added.
+  */
+	static const char begin[] = "# newprogram checks begin";
+	static const char end[] = "# newprogram checks end\n";
+	mdata *old = slurp(ctx, ctx->dirfd, "configure.ac", 0);
+	if (!old) return -1;
+	char *new = xmalloc(il->len + 1);
+	char *newend = iolgather(il, new);
+	*newend = 0;
+	char *ob = memmem(old->fro, old->to - old->fro, begin, strlen(begin));
+	char *oe = (ob) ? memmem(ob, old->to - ob, end, strlen(end)) : NULL;
+	char *nb = strstr(new, begin);
+	char *ne = (nb) ? strstr(nb, end) : NULL;
+	int res = 0;
+	if (!oe || !ne) {
+		fprintf(stderr, "configure.ac has no newprogram checks markers,"
+				" checks for new dependencies were not added.\n");
+	} else {
+		oe += strlen(end);
+		ne += strlen(end);
+		struct iovec iov[3] = {
+			{old->fro, ob - old->fro},
+			{nb, ne - nb},
+			{oe, old->to - oe}
+		};
+		iolist_t upd = {iov, 3, 3, iov[0].iov_len + iov[1].iov_len
+							+ iov[2].iov_len};
+		res = putiov(ctx, "configure.ac", &upd, "w");
+	}
+	keepout(ctx, new);
+	keepmd(ctx, old);
+	return res;
+} // updconfigure_ac()
+
+char
+*acstem(genctx_t *ctx, const profile_t *prof, const char *word, size_t len)
+{/* The name acchecks.cfg knows the source word..len by, NULL if it is
+  * not C. The main program and gopt go by the stubs they came from.
+  */
+	if (len < 3 || word[len - 2] != '.') return NULL;
+	if (word[len - 1] != 'c' && word[len - 1] != 'h') return NULL;
+	const char *src = ctx->pi->src;
+	if (strlen(src) == len && strncmp(word, src, len) == 0) {
+		char *stem = xstrdup(prof->mainstub);
+		size_t end = strlen(stem) - 1;
+		if (end && stem[end] == 'C') stem[end] = 0;
+		return stem;
+	}
+	const char *base = word;
+	const char *slash = memrchr(word, '/', len);
+	if (slash) base = slash + 1;
+	len -= (base - word) + 2;
+	if (len == 4 && strncmp(base, "gopt", 4) == 0 && ctx->req->fast_options) {
+		return xstrdup("fgopt");
+	}
+	char *stem = xmalloc(len + 1);
+	memcpy(stem, base, len);
+	stem[len] = 0;
+	return stem;
+} // acstem()
+
+void
+acjoin(mdata *md, const char *macro, char **items, size_t n)
+{/* Sorts items and appends them to md once each, as the argument list
+  * of macro or, if that is NULL, a line each. Nothing for no items.
+  */
+	if (!n) return;
+	qsort(items, n, sizeof(char *), cmpstrp);
+	if (macro) mdprintf(md, "%s([", macro);
+	size_t i;
+	for (i = 0; i < n; i++) {
+		if (i && strcmp(items[i], items[i - 1]) == 0) continue;
+		if (macro) {
+			mdprintf(md, (i) ? " %s" : "%s", items[i]);
+		} else {
+			mdprintf(md, "%s\n", items[i]);
+		}
+	}
+	if (macro) mdprintf(md, "])\n");
+} // acjoin()
+
+void
+storeaux(genctx_t *ctx)
+{ /* Share the files that autotools make the same in every project with
+   * the store. Those that make compares times on are reflinked, never
+   * hard linked, so that each project keeps its own times. Not being
+   * able to share is not an error.
+  */
+	static const struct {
+		const char *name;
+		int hardok;
+	} aux[] = {
+		{ "install-sh", 1 }, { "depcomp", 1 }, { "missing", 1 },
+		{ "compile", 1 }, { "config.guess", 1 }, { "config.sub", 1 },
+		{ "COPYING", 1 }, { "INSTALL", 1 },
+		{ "aclocal.m4", 0 }, { "configure", 0 },
+		{ NULL, 0 }
+	};
+	char path[PATH_MAX];
+	int i, n = 0;
+	for (i = 0; aux[i].name; i++) {
+		if (!exists_fileat(ctx->dirfd, aux[i].name)) continue;
+		int res = storein(inproject(ctx, path, aux[i].name),
+							aux[i].hardok);
+		if (res == -1) perror(path);
+		if (res == 1) n++;
+	}
+	if (ctx->req->log) {
+		fprintf(ctx->req->log, "%d files shared with the store\n", n);
+	}
+} // storeaux()
+
+int
+npstoregc(genctx_t *ctx, size_t *nobj, off_t *nbytes)
+{ /* Remove what no project uses from the store, see storegc(). Returns
+   * 0 or -1 with the reason in nperror(ctx).
+  */
+	if (storegc(nobj, nbytes) == -1) return seterrno(ctx, "store");
+	return 0;
+} // npstoregc()
+
+int
+tweakmain(genctx_t *ctx, const char *mainstub)
+{	/* Put the source file name where the stub has its own name. */
+	progid *pi = ctx->pi;
+	mdata *md = getfile(ctx, pi->src, PATH_MAX);
+	if (!md) return -1;
+	memreplace(md, (char *)mainstub, pi->src, PATH_MAX);
+	// TODO - fixup copyright in the target main program
+	return putmd(ctx, pi->src, md, "w");
+} // tweakmain()
+
+char
+*mkscratch(genctx_t *ctx)
+{ /* A new private dir for the autotools to run in for a tar stream, on
+   * tmpfs when there is one so that nothing need reach the disk. NULL on
+   * error.
+  */
+	const char *tries[] = { "/dev/shm", getenv("TMPDIR"), "/tmp", NULL };
+	char path[PATH_MAX];
+	int i;
+	for (i = 0; i < 3; i++) {
+		if (!tries[i]) continue;
+		snprintf(path, sizeof(path), "%s/newprogram.XXXXXX", tries[i]);
+		if (mkdtemp(path)) return xstrdup(path);
+	}
+	seterrno(ctx, "mkdtemp");
+	return NULL;
+} // mkscratch()
+
+void
+tarlater(genctx_t *ctx, const char *name, const iolist_t *il,
+			const char *src, int append)
+{ /* Have emittar() put name in the tar stream, from src if that is not
+   * NULL else from the pieces of il, which are not copied. If name is
+   * there already it is replaced, or with append added to.
+  */
+	tarmem_t *tm = tarmember(ctx, name);
+	if (!tm) {
+		if (ctx->ntm == ctx->tmcap) {
+			ctx->tmcap = (ctx->tmcap) ? 2 * ctx->tmcap : 32;
+			ctx->tm = realloc(ctx->tm, ctx->tmcap * sizeof(tarmem_t));
+			if (!ctx->tm) {
+				fputs("Out of memory.\n", stderr);
+				exit(EXIT_FAILURE);
+			}
+		}
+		tm = &ctx->tm[ctx->ntm++];
+		memset(tm, 0, sizeof(tarmem_t));
+		tm->name = xstrdup((char *)name);
+	} else if (!append || tm->src) {
+		free(tm->src);
+		tm->src = NULL;
+		tm->il.n = tm->il.len = 0;
+	}
+	if (src) {
+		tm->src = xstrdup((char *)src);
+		return;
+	}
+	size_t i;
+	for (i = 0; i < il->n; i++) {
+		ioladd(&tm->il, il->iov[i].iov_base, il->iov[i].iov_len);
+	}
+} // tarlater()
+
+tarmem_t
+*tarmember(genctx_t *ctx, const char *name)
+{ /* The member called name of the tar stream, or NULL. */
+	size_t i;
+	for (i = 0; i < ctx->ntm; i++) {
+		if (strcmp(ctx->tm[i].name, name) == 0) return &ctx->tm[i];
+	}
+	return NULL;
+} // tarmember()
+
+int
+addscratch(genctx_t *ctx, const char *dir, const char *rel)
+{ /* Put the files under dir, which is rel in the project, that are not
+   * in the tar stream yet into it. They are what the autotools made,
+   * less autom4te.cache as tar.c leaves it out.
+  */
+	DIR *dp = opendir(dir);
+	if (!dp) return -1;
+	struct dirent *de;
+	int res = 0;
+	while (res == 0 && (de = readdir(dp))) {
+		const char *n = de->d_name;
+		if (strcmp(n, ".") == 0 || strcmp(n, "..") == 0 ||
+				strcmp(n, "autom4te.cache") == 0) continue;
+		char path[PATH_MAX], name[PATH_MAX];
+		if (snprintf(path, sizeof(path), "%s/%s", dir, n) >= PATH_MAX ||
+				snprintf(name, sizeof(name), "%s%s", rel, n) >= PATH_MAX) {
+			errno = ENAMETOOLONG;
+			res = -1;
+			break;
+		}
+		struct stat sb;
+		if (stat(path, &sb) == -1) {
+			res = -1;
+		} else if (S_ISDIR(sb.st_mode)) {
+			strcat(name, "/");
+			res = addscratch(ctx, path, name);
+		} else if (S_ISREG(sb.st_mode) && !tarmember(ctx, name)) {
+			tarlater(ctx, name, NULL, path, 0);
+		}
+	}
+	closedir(dp);
+	return res;
+} // addscratch()
+
+int
+cmptarmem(const void *a, const void *b)
+{ /* qsort() by name, '/' first so that a dir's files follow it as in
+   * a tree walk.
+  */
+	const unsigned char *l = (const unsigned char *)
+								((const tarmem_t *)a)->name;
+	const unsigned char *r = (const unsigned char *)
+								((const tarmem_t *)b)->name;
+	while (*l && *l == *r) {
+		l++;
+		r++;
+	}
+	int lc = (*l == '/') ? 1 : (*l) ? *l + 1 : 0;
+	int rc = (*r == '/') ? 1 : (*r) ? *r + 1 : 0;
+	return lc - rc;
+} // cmptarmem()
+
+int
+emittar(genctx_t *ctx, const char *name, const char *scratch)
+{ /* Write the project to the tar stream as dir name, from memory and
+   * where the components are, and what the autotools made in scratch
+   * if that is not NULL. The members are in name order, as tar.c would
+   * put them.
+  */
+	FILE *fp = ctx->req->tar;
+	if (scratch && addscratch(ctx, scratch, "") == -1) {
+		return seterrno(ctx, scratch);
+	}
+	qsort(ctx->tm, ctx->ntm, sizeof(tarmem_t), cmptarmem);
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/", name);
+	int res = tarmkdir(fp, path);
+	const char *prev = "";
+	size_t i;
+	for (i = 0; i < ctx->ntm && res == 0; i++) {
+		const tarmem_t *tm = &ctx->tm[i];
+		// the dirs it is in, unless the one before was in them too.
+		const char *sl;
+		for (sl = strchr(tm->name, '/'); sl && res == 0;
+				sl = strchr(sl + 1, '/')) {
+			int len = sl - tm->name + 1;
+			if (strncmp(prev, tm->name, len) == 0) continue;
+			snprintf(path, sizeof(path), "%s/%.*s", name, len, tm->name);
+			res = tarmkdir(fp, path);
+		}
+		if (res == -1) break;
+		if (snprintf(path, sizeof(path), "%s/%s", name, tm->name)
+				>= PATH_MAX) {
+			errno = ENAMETOOLONG;
+			res = -1;
+		} else if (tm->src) {
+			res = tarpath(fp, tm->src, path);
+		} else {
+			res = tariov(fp, path, tm->il.iov, tm->il.n, tm->il.len);
+		}
+		prev = tm->name;
+	}
+	if (res == 0) res = tarend(fp);
+	if (res == -1) return seterrno(ctx, "Writing the tar stream");
+	return 0;
+} // emittar()
+
+void
+freetar(genctx_t *ctx)
+{ /* The tar stream's members and what their pieces are in. */
+	size_t i;
+	for (i = 0; i < ctx->ntm; i++) {
+		free(ctx->tm[i].name);
+		free(ctx->tm[i].src);
+		freeiol(&ctx->tm[i].il);
+	}
+	free(ctx->tm);
+	ctx->tm = NULL;
+	ctx->ntm = ctx->tmcap = 0;
+	freekeep(ctx);
+} // freetar()
+
+int
+rmentry(const char *path, const struct stat *sb, int type,
+			struct FTW *ftw)
+{ /* nftw() callback that removes the scratch dir, bottom up. */
+	(void)sb;
+	(void)ftw;
+	forgetstat(AT_FDCWD, path);
+	if (type == FTW_DP) {
+		rmdir(path);
+	} else {
+		unlink(path);
+	}
+	return 0;
+} // rmentry()
@@ -0,0 +1,72 @@
+/*    libnewprogram.h
+ *
+ * Copyright 2017 Robert L (Bob) Parker rlp1938@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+/* The purpose of libnewprogram.[h|c] is to generate a new project, all
+ * of what newprogram does apart from options processing, in a form that
+ * other programs can call. Everything a generation needs lives in its
+ * genctx_t, so that several threads may each generate with their own
+ * context at once. Errors are returned, not exit()'d on, except for
+ * running out of memory.
+ * */
+#ifndef _LIBNEWPROGRAM_H
+#define _LIBNEWPROGRAM_H
+#include <stdio.h>
+#include <sys/types.h>
+
+typedef struct genreq_t {	/* what to generate, as newprogram's options */
+	const char *name;			// the project name.
+	const char *software_deps;	// --depends, component files.
+	const char *extra_data;		// --extra-dist, files to distribute.
+	const char *options_list;	// --options-list, optcodes.
+	const char *options_file;	// --options-file, optcodes by line.
+	const char *profile;		// --profile, NULL for main.
+	int hasopts;				// --with-options.
+	int fast_options;			// --fast-options.
+	int with_bench;				// --with-bench.
+	const char *link_mode;		// --link-mode, NULL for complink.
+	int update;					// --update, write only what changed.
+	int store;					// --store, share autotools files.
+	const char *build_system;	// --build-system, NULL for autotools.
+	int pch;					// --pch, precompile common.h.
+	int unity;					// --unity, a one translation unit target.
+	int complib;				// --complib, link libcomponents.a.
+	FILE *tar;					// --emit tar, the archive goes here
+								// in place of progdir, may be NULL.
+	FILE *log;					// names and paths go here, may be NULL.
+} genreq_t;
+
+typedef struct genctx_t genctx_t;
+
+genctx_t
+*npnew(void);
+
+int
+npgenerate(genctx_t *ctx, const genreq_t *req);
+
+const char
+*nperror(const genctx_t *ctx);
+
+void
+npfree(genctx_t *ctx);
+
+int
+npstoregc(genctx_t *ctx, size_t *nobj, off_t *nbytes);
+
+#endif
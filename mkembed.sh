@@ -0,0 +1,44 @@
+#!/bin/sh
+# mkembed.sh - writes embed.c, the stubs compiled into newprogram.
+# usage: mkembed.sh srcdir stub1 stub2 ... > embed.c
+# Each stub comes with the offsets of its "%s" and "target */", where
+# renderstub() in stubs.c looks for placeholders.
+srcdir=$1
+shift
+echo "/* embed.c - generated by mkembed.sh from the stubs, do not edit. */"
+echo
+echo '#include "embed.h"'
+n=0
+for f in "$@"; do
+	echo
+	echo "static const unsigned char stub$n[] = {"
+	od -An -v -tx1 "$srcdir/$f" | sed -e 's/ *\([0-9a-f][0-9a-f]\)/0x\1,/g' \
+		-e 's/^/	/'
+	echo "	0x00"
+	echo "};"
+	echo "static const unsigned marks$n[] = {"
+	LC_ALL=C awk '{
+		for (i = 1; i <= length($0); i++) {
+			if (substr($0, i, 2) == "%s" || substr($0, i, 9) == "target */")
+				printf "\t%d,\n", off + i - 1
+		}
+		off += length($0) + 1
+	}' "$srcdir/$f"
+	echo "	0"
+	echo "};"
+	n=`expr $n + 1`
+done
+echo
+echo "const embed_t embedded[] = {"
+n=0
+for f in "$@"; do
+	echo "	{\"$f\",	(const char *)stub$n,	sizeof(stub$n) - 1,	marks$n,"
+	echo "		sizeof(marks$n) / sizeof(unsigned) - 1},"
+	n=`expr $n + 1`
+done
+echo "	{NULL,	NULL,	0,	NULL,	0}"
+echo "};"
+echo
+# cksum's CRC and length of the names and content of all the stubs.
+sum=`for f in "$@"; do echo "$f"; cat "$srcdir/$f"; done | cksum`
+printf 'const uint64_t embedsum = 0x%08x%08xULL;\n' $sum
@@ -0,0 +1,40 @@
+# generated by newprogram. `ninja` builds exe%s, set opt_cflags below to
+# -O2 -DNDEBUG to optimise, with -flto for link time optimisation.
+# Header dependencies are kept by ninja from the depfile gcc writes for
+# each object. `ninja install` and `ninja dist` do the obvious.
+
+cc = cc
+opt_cflags = -g -O0
+cflags = -Wall -Wextra $opt_cflags
+cppflags = -I. -D_GNU_SOURCE=1
+ldflags =
+libs =
+prefix = /usr/local
+
+rule cc
+  command = $cc -MMD -MF $out.d $cppflags $pch $cflags -c $in -o $out
+  depfile = $out.d
+  deps = gcc
+  description = CC $out
+
+rule link
+  command = $cc $cflags $ldflags -o $out $in $libs
+  description = LINK $out
+
+rule install
+  command = install -d $prefix/bin $prefix/share/man/man1 && $
+    install -m 755 exe%s $prefix/bin/ && $
+    install -m 644 man%s $prefix/share/man/man1/inst%s
+  pool = console
+
+rule dist
+  command = tar -czf $out --transform 's,^,exe%s/,' $in
+  description = DIST $out
+
+edges%s
+build exe%s: link objs%s
+build install: install exe%s | man%s
+build exe%s.tar.gz: dist build.ninja dist%s
+build dist: phony exe%s.tar.gz
+
+default exe%s
@@ -0,0 +1,12 @@
+
+# Benchmark harness. `ninja runbench` builds and runs it, set
+# bench_flags to pass harness options, eg -r 1000 -c 2.
+bench_flags =
+
+rule runbench
+  command = ./bench/bench $bench_flags
+  pool = console
+
+edges%s
+build bench/bench: link objs%s
+build runbench: runbench bench/bench
@@ -0,0 +1,8 @@
+
+# Precompiled header, see common.h. It is made into common.h.gch before
+# the objects are compiled, and again whenever the flags change.
+rule pch
+  command = $cc $cppflags $cflags -x c-header $in -o $out
+  description = PCH $out
+
+build common.h.gch: pch common.h
@@ -0,0 +1,13 @@
+
+# Unity build. `ninja unity` builds exe%s-unity from exe%s-unity.c,
+# which includes each of the sources, as one translation unit. So no
+# two of them may have static names in common. ninja can't build
+# exe%s two ways, hence the other name.
+rule unity
+  command = printf '#include "%s"\n' $in > $out
+  description = UNITY $out
+
+build exe%s-unity.c: unity src%s
+edges%s
+build exe%s-unity: link exe%s-unity.o
+build unity: phony exe%s-unity
@@ -0,0 +1,11 @@
+
+# Precompiled header, see common.h. It is made into common.h.gch before
+# anything else is compiled. gcc reads common.h itself if the .gch was
+# made with other flags, add -Winvalid-pch to CFLAGS to be told.
+BUILT_SOURCES=common.h.gch
+MOSTLYCLEANFILES=common.h.gch
+AM_CPPFLAGS=-include common.h
+$(exe%s_OBJECTS): common.h.gch
+common.h.gch: common.h Makefile
+	$(CC) $(DEFS) $(DEFAULT_INCLUDES) $(INCLUDES) $(CPPFLAGS) \
+		$(AM_CFLAGS) $(CFLAGS) -x c-header -o $@ $(srcdir)/common.h
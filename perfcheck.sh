@@ -0,0 +1,122 @@
+#!/bin/sh
+# perfcheck.sh - times whole runs of newprogram against a baseline.
+# usage: perfcheck.sh [-w] newprogram perfrun baseline
+# Generates PERF_RUNS (5) projects of each kind, in a HOME made on a
+# tmpfs so that the disk is not what is measured:
+#   small    two components, no options.
+#   options  --fast-options with PERF_OPTS (300) options from a file.
+#   deps     PERF_DEPS (40) components.
+# For each phase it reports, per project, the wall, user and sys times
+# in ms, the peak RSS in kB of newprogram or any tool it ran, and when
+# strace is installed the number of system calls. Any metric more than
+# PERF_THRESHOLD (20) percent and PERF_SLACK (25) units above the
+# baseline fails the check. With -w, or if there is no baseline yet,
+# the results are written to it instead.
+write=no
+if [ "$1" = "-w" ]; then
+	write=yes
+	shift
+fi
+if [ $# -ne 3 ]; then
+	echo "usage: perfcheck.sh [-w] newprogram perfrun baseline" >&2
+	exit 2
+fi
+np=`cd \`dirname $1\` && pwd`/`basename $1`
+pr=`cd \`dirname $2\` && pwd`/`basename $2`
+base=$3
+runs=${PERF_RUNS:-5}
+nopts=${PERF_OPTS:-300}
+ndeps=${PERF_DEPS:-40}
+threshold=${PERF_THRESHOLD:-20}
+slack=${PERF_SLACK:-25}
+
+tmp=
+for d in /dev/shm ${TMPDIR:-/tmp} /tmp; do
+	tmp=`mktemp -d $d/perfcheck.XXXXXX 2>/dev/null` && break
+done
+if [ -z "$tmp" ]; then
+	echo "perfcheck.sh: can't make a scratch dir." >&2
+	exit 2
+fi
+trap 'rm -rf "$tmp"' 0 1 2 15
+HOME=$tmp/home
+export HOME
+comp=$HOME/Documents/Programs/Srclib/Components
+mkdir -p $comp $HOME/Documents/Programs/Srclib/Stubs
+srcdir=`dirname $0`
+cp $srcdir/str.[ch] $srcdir/files.[ch] $srcdir/dirs.[ch] $comp/
+deps="str.h+c files.h+c"
+i=0
+while [ $i -lt $ndeps ]; do
+	printf '#ifndef _DEP%d_H\n#define _DEP%d_H\nint dep%d(void);\n#endif\n' \
+		$i $i $i > $comp/dep$i.h
+	printf '#include "dep%d.h"\nint dep%d(void) { return %d; }\n' \
+		$i $i $i > $comp/dep$i.c
+	deps="$deps dep$i.h+c"
+	i=`expr $i + 1`
+done
+i=0
+while [ $i -lt $nopts ]; do
+	echo "-opt$i: Option number $i." >> $tmp/options
+	i=`expr $i + 1`
+done
+
+# phase name, then the arguments for newprogram less the project name.
+phase() {
+	name=$1
+	shift
+	r=`$pr $runs $np "$@" "Perf%d" 2>$tmp/err` || {
+		cat $tmp/err >&2
+		echo "perfcheck.sh: phase $name failed." >&2
+		exit 1
+	}
+	rm -rf $HOME/Documents/Programs/Perf*
+	calls=-
+	if command -v strace >/dev/null 2>&1; then
+		strace -f -c -o $tmp/strace $np "$@" Perfs >/dev/null 2>&1
+		calls=`awk '$NF == "total" { print $(NF-2) }' $tmp/strace`
+		rm -rf $HOME/Documents/Programs/Perf*
+	fi
+	set -- $r
+	echo "$name wall_ms $1"
+	echo "$name user_ms $2"
+	echo "$name sys_ms $3"
+	echo "$name maxrss_kb $4"
+	[ "$calls" != "-" ] && echo "$name syscalls $calls"
+	return 0
+}
+
+{
+	phase small -d "str.h+c files.h+c"
+	phase options -f -F $tmp/options -d "str.h+c files.h+c dirs.h+c"
+	phase deps -d "$deps"
+} > $tmp/now || exit 1
+
+if [ $write = yes ] || [ ! -f $base ]; then
+	cp $tmp/now $base
+	cat $base
+	echo "perfcheck.sh: baseline written to $base"
+	exit 0
+fi
+awk -v t=$threshold -v s=$slack '
+	NR == FNR { base[$1 " " $2] = $3; next }
+	{
+		key = $1 " " $2
+		if (!(key in base)) {
+			printf "%-26s %10s %10d  new\n", key, "-", $3
+			next
+		}
+		b = base[key]
+		verdict = "ok"
+		if ($3 > b * (1 + t / 100) && $3 > b + s) {
+			verdict = "REGRESSED"
+			bad++
+		}
+		printf "%-26s %10d %10d  %s\n", key, b, $3, verdict
+	}
+	END {
+		if (bad) {
+			printf "%d metric(s) regressed more than %d%%.\n", bad, t
+			exit 1
+		}
+	}' $base $tmp/now
@@ -0,0 +1,130 @@
+/*    perfrun.c
+ *
+ * Copyright 2017 Robert L (Bob) Parker rlp1938@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+/* The purpose of perfrun.c is to time a command run n times over for
+ * perfcheck.sh. Usage: perfrun n command [arg ...], where any "%d" in
+ * an arg is replaced by the run number so that each run may make a
+ * project of its own. The command's stdout goes to /dev/null, perfrun
+ * writes one line to its own:
+ *   wall_ms user_ms sys_ms maxrss_kb
+ * the times being per run and summed over the command and everything it
+ * waited for, maxrss the largest of any of those processes.
+ * */
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+static double ms(struct timeval tv);
+static char **runargs(char **argv, int run);
+
+int main(int argc, char **argv)
+{
+	if (argc < 3 || atoi(argv[1]) < 1) {
+		fputs("Usage: perfrun n command [arg ...]\n", stderr);
+		exit(EXIT_FAILURE);
+	}
+	int n = atoi(argv[1]);
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	int i;
+	for (i = 0; i < n; i++) {
+		char **args = runargs(argv + 2, i);
+		pid_t pid = fork();
+		if (pid == -1) {
+			perror("fork");
+			exit(EXIT_FAILURE);
+		}
+		if (pid == 0) {
+			int fd = open("/dev/null", O_WRONLY);
+			if (fd != -1) dup2(fd, STDOUT_FILENO);
+			execvp(args[0], args);
+			perror(args[0]);
+			_exit(127);
+		}
+		int status;
+		while (waitpid(pid, &status, 0) == -1) {
+			if (errno != EINTR) {
+				perror("waitpid");
+				exit(EXIT_FAILURE);
+			}
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+			fprintf(stderr, "%s failed on run %d.\n", args[0], i);
+			exit(EXIT_FAILURE);
+		}
+		int j;
+		for (j = 0; args[j]; j++) free(args[j]);
+		free(args);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	double wall = (t1.tv_sec - t0.tv_sec) * 1e3
+					+ (t1.tv_nsec - t0.tv_nsec) / 1e6;
+	// Counts the autotools that newprogram waited for as well.
+	struct rusage ru;
+	getrusage(RUSAGE_CHILDREN, &ru);
+	printf("%.0f %.0f %.0f %ld\n", wall / n, ms(ru.ru_utime) / n,
+			ms(ru.ru_stime) / n, ru.ru_maxrss);
+	return 0;
+}//main()
+
+double
+ms(struct timeval tv)
+{
+	return tv.tv_sec * 1e3 + tv.tv_usec / 1e3;
+} // ms()
+
+char
+**runargs(char **argv, int run)
+{ /* A copy of argv with each "%d" replaced by run. */
+	int argc;
+	for (argc = 0; argv[argc]; argc++) ;
+	char **args = malloc((argc + 1) * sizeof(char *));
+	if (!args) {
+		fputs("Out of memory.\n", stderr);
+		exit(EXIT_FAILURE);
+	}
+	int i;
+	for (i = 0; i < argc; i++) {
+		char *pc = strstr(argv[i], "%d");
+		size_t len = strlen(argv[i]) + 16;
+		args[i] = malloc(len);
+		if (!args[i]) {
+			fputs("Out of memory.\n", stderr);
+			exit(EXIT_FAILURE);
+		}
+		if (pc) {
+			snprintf(args[i], len, "%.*s%d%s", (int)(pc - argv[i]),
+						argv[i], run, pc + 2);
+		} else {
+			strcpy(args[i], argv[i]);
+		}
+	}
+	args[argc] = NULL;
+	return args;
+} // runargs()
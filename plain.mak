@@ -0,0 +1,42 @@
+# generated by newprogram, a plain non-recursive Makefile.
+# `make` builds exe%s, `make OPT_CFLAGS="-O2 -DNDEBUG"` optimises and
+# adding -flto to that does link time optimisation. Header dependencies
+# are tracked by the .d files that -MMD writes beside each object.
+
+OPT_CFLAGS=-g -O0
+ALL_CFLAGS=-Wall -Wextra $(OPT_CFLAGS) $(CFLAGS)
+ALL_CPPFLAGS=-I. -D_GNU_SOURCE=1 $(CPPFLAGS)
+PREFIX=/usr/local
+
+PROG=exe%s
+SRCS=src%s
+MANS=man%s
+DATA=dat%s
+LDADD=lda%s
+OBJS=$(patsubst %.c,%.o,$(filter %.c,$(SRCS)))
+CLEANFILES=$(PROG) $(OBJS) $(OBJS:.o=.d) $(PROG).tar.gz
+
+.PHONY: all clean install dist
+all: $(PROG)
+
+$(PROG): $(OBJS) $(LDADD)
+	$(CC) $(ALL_CFLAGS) $(LDFLAGS) -o $@ $(OBJS) $(LDADD) $(LDLIBS)
+
+%.o: %.c
+	$(CC) $(ALL_CPPFLAGS) $(ALL_CFLAGS) -MMD -MP -c -o $@ $<
+
+clean:
+	rm -f $(CLEANFILES)
+
+install: $(PROG)
+	install -d $(DESTDIR)$(PREFIX)/bin $(DESTDIR)$(PREFIX)/share/man/man1
+	install -m 755 $(PROG) $(DESTDIR)$(PREFIX)/bin/
+	install -m 644 $(MANS) $(DESTDIR)$(PREFIX)/share/man/man1/
+	$(if $(strip $(DATA)),install -d $(DESTDIR)$(PREFIX)/share/$(PROG))
+	$(if $(strip $(DATA)),install -m 644 $(DATA) $(DESTDIR)$(PREFIX)/share/$(PROG)/)
+
+dist: $(PROG).tar.gz
+$(PROG).tar.gz: Makefile $(SRCS) $(MANS) $(DATA) $(LDADD)
+	tar -czf $@ --transform 's,^,$(PROG)/,' $^
+
+-include $(OBJS:.o=.d)
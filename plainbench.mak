@@ -0,0 +1,14 @@
+
+# Benchmark harness. `make bench` builds and runs it, pass harness
+# options with eg `make bench BENCH_FLAGS="-r 1000 -c 2"`.
+BENCH_SRCS=bench/bench.c bench/bench.hdep%s
+BENCH_OBJS=$(patsubst %.c,%.o,$(filter %.c,$(BENCH_SRCS)))
+BENCH_FLAGS=
+CLEANFILES+=bench/bench bench/bench.o bench/bench.d
+.PHONY: bench
+bench: bench/bench
+	./bench/bench $(BENCH_FLAGS)
+bench/bench: $(BENCH_OBJS) $(LDADD)
+	$(CC) $(ALL_CFLAGS) $(LDFLAGS) -o $@ $(BENCH_OBJS) $(LDADD) $(LDLIBS)
+$(PROG).tar.gz: bench/bench.c bench/bench.h
+-include bench/bench.d
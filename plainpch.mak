@@ -0,0 +1,10 @@
+
+# Precompiled header, see common.h. It is made into common.h.gch before
+# the objects are compiled. gcc reads common.h itself if the .gch was
+# made with other flags, add -Winvalid-pch to CFLAGS to be told.
+PCH_CPPFLAGS:=$(ALL_CPPFLAGS)
+ALL_CPPFLAGS+=-include common.h
+CLEANFILES+=common.h.gch
+$(OBJS) $(BENCH_OBJS): common.h.gch
+common.h.gch: common.h Makefile
+	$(CC) $(PCH_CPPFLAGS) $(ALL_CFLAGS) -x c-header -o $@ common.h
@@ -0,0 +1,11 @@
+
+# Unity build. `make unity` builds $(PROG) from $(PROG)-unity.c, which
+# includes each of its sources, as one translation unit. So no two of
+# them may have static names in common. Other targets build an object
+# per source as usual unless given OBJS as unity does.
+CLEANFILES+=$(PROG)-unity.c $(PROG)-unity.o $(PROG)-unity.d
+.PHONY: unity
+unity: $(PROG)-unity.c
+	$(MAKE) OBJS=$(PROG)-unity.o
+$(PROG)-unity.c: Makefile
+	printf '#include "%s"\n' $(SRCS) > $@
@@ -0,0 +1,671 @@
+/*    store.c
+ *
+ * Copyright 2017 Robert L (Bob) Parker rlp1938@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+/* An object is named by the FNV-1a hash of its content, with an 'x'
+ * after it if it is executable, and sits at store/ab/cdef... Objects
+ * are read only so that a tool writing in place, rather than making a
+ * new file and renaming it, can't change every project's copy at once.
+ * Hard linked objects count their projects in st_nlink, so storegc()
+ * removes those with a count of 1. A reflinked project file is a file
+ * of its own and does not need the object to stay.
+ *
+ * The components get the same treatment compiled. complib/<hash>/ holds
+ * libcomponents.a with the sources it was built from, the hash being of
+ * the compiler, its flags and the names and content of every .c and .h
+ * in compdir. So a changed component makes a new version, and projects
+ * that hard link the old one keep it until storegc() finds none do.
+ * Projects are never given symlinks into a version, a reflink or copy
+ * of it is their own as for the store. Users of a version hold a shared
+ * flock() on the complib dir until their links are made, storegc() an
+ * exclusive one, so it can't take a version from under them.
+ * */
+
+#include <stdint.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <linux/fs.h>
+#include "store.h"
+
+static char *objpath(char *buf, uint64_t hash, int exec);
+static char *tmpname(char *buf, const char *path);
+static int sameas(const char *path, const char *obj, size_t len);
+static int mkdirs(const char *path);
+static int gcdir(const char *dir, size_t *nobj, off_t *nbytes);
+static int hashfd(int fd, uint64_t *h, size_t *len);
+static int cmpname(const void *a, const void *b);
+static int listsrcs(const char *dir, char ***names, size_t *n);
+static int buildlib(const char *compdir, const char *flags, char **names,
+					size_t n, const char *tmp);
+static int runwait(char **argv, pid_t *pid);
+static int copyin(const char *src, const char *dst);
+static int rmflat(const char *dir, size_t *nobj, off_t *nbytes);
+static int gclibs(const char *dir, size_t *nobj, off_t *nbytes);
+static int lockdir(const char *dir, int op);
+
+#define FNV_BASIS	14695981039346656037ULL
+#define FNV_PRIME	1099511628211ULL
+#define LIBNAME		"libcomponents.a"
+
+int
+storein(const char *path, int hardok)
+{ /* Replace the file at path with a hard link to its object in the
+   * store, or if hardok is 0 or there can't be one, with a reflink of
+   * it. Returns 1 if that was done, 0 if path was left as it is and -1
+   * on error.
+  */
+	struct stat sb;
+	if (lstat(path, &sb) == -1) return -1;
+	if (!S_ISREG(sb.st_mode)) return 0;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) return -1;
+	uint64_t h = FNV_BASIS;
+	size_t len = 0;
+	int res = hashfd(fd, &h, &len);
+	close(fd);
+	if (res == -1) return -1;
+	char obj[PATH_MAX], tmp[PATH_MAX];
+	objpath(obj, h, (sb.st_mode & S_IXUSR) != 0);
+	struct stat ob;
+	if (stat(obj, &ob) == 0) {
+		if (ob.st_dev == sb.st_dev && ob.st_ino == sb.st_ino) return 1;
+		int same = sameas(path, obj, len);
+		if (same != 1) return same;	// a hash collision, or error.
+	} else {	// new object, made from path itself.
+		if (errno != ENOENT || mkdirs(obj) == -1) return -1;
+		tmpname(tmp, obj);
+		int res = (hardok) ? link(path, tmp) : -1;
+		if (res == -1 && (!hardok || cantshare(errno))) {
+			res = reflink(path, tmp);
+		}
+		if (res == -1) return (cantshare(errno)) ? 0 : -1;
+		if (chmod(tmp, sb.st_mode & 0555) == -1
+				|| rename(tmp, obj) == -1) {
+			unlink(tmp);
+			return -1;
+		}
+		return 1;	// path is the object or shares its blocks now.
+	}
+	/* Link or reflink the object in beside path and rename it over. A
+	 * reflink keeps path's times, make depends on them.
+	*/
+	tmpname(tmp, path);
+	int linked = 0;
+	if (hardok) {
+		if (link(obj, tmp) == 0) linked = 1;
+		else if (!cantshare(errno)) return -1;
+	}
+	if (!linked) {
+		if (reflink(obj, tmp) == -1) return (cantshare(errno)) ? 0 : -1;
+		struct timespec times[2] = { sb.st_atim, sb.st_mtim };
+		if (chmod(tmp, sb.st_mode & 07777) == -1
+				|| utimensat(AT_FDCWD, tmp, times, 0) == -1) {
+			unlink(tmp);
+			return -1;
+		}
+	}
+	forgetstat(AT_FDCWD, path);
+	if (rename(tmp, path) == -1) {
+		unlink(tmp);
+		return -1;
+	}
+	return 1;
+} // storein()
+
+int
+storegc(size_t *nobj, off_t *nbytes)
+{ /* Remove the objects and versions of libcomponents.a no project links
+   * to, counting their files and bytes into *nobj and *nbytes.
+  */
+	*nobj = 0;
+	*nbytes = 0;
+	char dir[PATH_MAX];
+	sprintf(dir, "%s/.cache/newprogram/complib", getenv("HOME"));
+	if (gclibs(dir, nobj, nbytes) == -1) return -1;
+	sprintf(dir, "%s/.cache/newprogram/store", getenv("HOME"));
+	DIR *dp = opendir(dir);
+	if (!dp) return (errno == ENOENT) ? 0 : -1;
+	struct dirent *de;
+	int res = 0;
+	while ((de = readdir(dp)) && res == 0) {
+		if (de->d_name[0] == '.') continue;
+		char sub[PATH_MAX];
+		if (snprintf(sub, PATH_MAX, "%s/%s", dir, de->d_name)
+				>= PATH_MAX) continue;
+		res = gcdir(sub, nobj, nbytes);
+	}
+	closedir(dp);
+	return res;
+} // storegc()
+
+int
+complib(const char *compdir, const char *flags, char *libdir)
+{ /* Put the dir of the libcomponents.a built with flags from compdir as
+   * it is now into libdir, which must be PATH_MAX, building it there
+   * first if there is none. Sources that don't compile on their own are
+   * left out, which the caller sees by their absence from libdir.
+   * Returns a descriptor holding the lock that keeps storegc() off the
+   * version, for the caller to close() once its links are made.
+  */
+	char **names;
+	size_t n, i;
+	if (listsrcs(compdir, &names, &n) == -1) return -1;
+	const char *cc = (getenv("CC")) ? getenv("CC") : "cc";
+	uint64_t h = FNV_BASIS;
+	const char *keys[] = { cc, flags };
+	int res = 0;
+	for (i = 0; i < 2 + n && res == 0; i++) {
+		const char *key = (i < 2) ? keys[i] : names[i - 2];
+		const char *cp;
+		for (cp = key; ; cp++) {	// the NUL too, so "ab" "c" != "a" "bc"
+			h ^= (unsigned char)*cp;
+			h *= FNV_PRIME;
+			if (!*cp) break;
+		}
+		if (i < 2) continue;
+		char path[PATH_MAX];
+		snprintf(path, PATH_MAX, "%s/%s", compdir, key);
+		int fd = open(path, O_RDONLY | O_CLOEXEC);
+		size_t len = 0;
+		res = (fd == -1) ? -1 : hashfd(fd, &h, &len);
+		if (fd != -1) close(fd);
+	}
+	snprintf(libdir, PATH_MAX, "%s/.cache/newprogram/complib/%016llx",
+				getenv("HOME"), (unsigned long long)h);
+	char path[PATH_MAX], tmp[PATH_MAX];
+	int lockfd = -1;
+	if (res == 0 && mkdirs(libdir) == 0) {
+		strcpy(path, libdir);
+		*strrchr(path, '/') = 0;
+		lockfd = lockdir(path, LOCK_SH);
+	}
+	if (lockfd == -1) res = -1;
+	snprintf(path, PATH_MAX, "%s/" LIBNAME, libdir);
+	struct stat sb;
+	if (res == 0 && stat(path, &sb) == -1) {	// not built yet.
+		tmpname(tmp, libdir);
+		if (mkdir(tmp, 0775) == -1) {
+			res = -1;
+		} else {
+			res = buildlib(compdir, flags, names, n, tmp);
+			// Another process may have built it meanwhile.
+			if (res == 0 && rename(tmp, libdir) == -1
+					&& errno != ENOTEMPTY && errno != EEXIST) {
+				res = -1;
+			}
+			int err = errno;
+			size_t nobj;
+			off_t nbytes;
+			rmflat(tmp, &nobj, &nbytes);	// gone already if renamed.
+			errno = err;
+		}
+	}
+	for (i = 0; i < n; i++) free(names[i]);
+	free(names);
+	if (res == -1 && lockfd != -1) {
+		int err = errno;
+		close(lockfd);
+		errno = err;
+	}
+	return (res == -1) ? -1 : lockfd;
+} // complib()
+
+int
+reflink(const char *src, const char *target)
+{ /* Make target share src's data blocks, as `cp --reflink=always`.
+   * Returns 0, or -1 with errno set and no target left behind.
+  */
+#ifdef FICLONE
+	int sfd = open(src, O_RDONLY | O_CLOEXEC);
+	if (sfd == -1) return -1;
+	int tfd = open(target, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+	if (tfd == -1) {
+		close(sfd);
+		return -1;
+	}
+	int res = ioctl(tfd, FICLONE, sfd);
+	int err = errno;
+	close(sfd);
+	if (close(tfd) == -1 && res == 0) {
+		res = -1;
+		err = errno;
+	}
+	if (res == -1) {
+		unlink(target);
+		errno = err;
+	}
+	return res;
+#else
+	(void)src;
+	(void)target;
+	errno = EOPNOTSUPP;
+	return -1;
+#endif
+} // reflink()
+
+int
+hashfd(int fd, uint64_t *h, size_t *len)
+{ /* Continue the FNV-1a hash *h with what is left to read of fd,
+   * adding the bytes read to *len. */
+	char buf[65536];
+	ssize_t got;
+	while ((got = read(fd, buf, sizeof(buf))) != 0) {
+		if (got == -1) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		ssize_t i;
+		for (i = 0; i < got; i++) {
+			*h ^= (unsigned char)buf[i];
+			*h *= FNV_PRIME;
+		}
+		*len += got;
+	}
+	return 0;
+} // hashfd()
+
+char
+*objpath(char *buf, uint64_t hash, int exec)
+{ /* Where the object for hash lives, buf must be PATH_MAX. */
+	snprintf(buf, PATH_MAX, "%s/.cache/newprogram/store/%02x/%014llx%s",
+				getenv("HOME"), (unsigned)(hash >> 56),
+				(unsigned long long)(hash & 0xffffffffffffffULL),
+				(exec) ? "x" : "");
+	return buf;
+} // objpath()
+
+char
+*tmpname(char *buf, const char *path)
+{ /* A name beside path that no other process or thread will use. */
+	static unsigned long seq;
+	unsigned long n = __atomic_add_fetch(&seq, 1, __ATOMIC_RELAXED);
+	if (snprintf(buf, PATH_MAX, "%s.%d.%lu.tmp", path, (int)getpid(), n)
+			>= PATH_MAX) {
+		buf[0] = 0;	// too long, whatever uses it fails with ENOENT.
+	}
+	return buf;
+} // tmpname()
+
+int
+sameas(const char *path, const char *obj, size_t len)
+{ /* 1 if the files at path and obj are the same len bytes, else 0, -1
+   * on error. */
+	struct stat sb;
+	if (stat(obj, &sb) == -1) return -1;
+	if ((size_t)sb.st_size != len) return 0;
+	int fa = open(path, O_RDONLY | O_CLOEXEC);
+	if (fa == -1) return -1;
+	int fb = open(obj, O_RDONLY | O_CLOEXEC);
+	if (fb == -1) {
+		close(fa);
+		return -1;
+	}
+	char a[16384], b[16384];
+	int res = 1;
+	size_t done = 0;
+	while (done < len && res == 1) {
+		size_t want = (len - done < sizeof(a)) ? len - done : sizeof(a);
+		if (read(fa, a, want) != (ssize_t)want
+				|| read(fb, b, want) != (ssize_t)want) {
+			res = -1;
+		} else if (memcmp(a, b, want) != 0) {
+			res = 0;
+		}
+		done += want;
+	}
+	close(fa);
+	close(fb);
+	return res;
+} // sameas()
+
+int
+mkdirs(const char *path)
+{ /* mkdir -p of the dir path is in. */
+	char buf[PATH_MAX];
+	strcpy(buf, path);
+	char *cp = buf + 1;
+	while ((cp = strchr(cp, '/'))) {
+		*cp = 0;
+		if (mkdir(buf, 0775) == -1 && errno != EEXIST) return -1;
+		*cp++ = '/';
+	}
+	return 0;
+} // mkdirs()
+
+int
+cantshare(int err)
+{ /* Does err mean that links or reflinks can't be made between these
+   * places, as opposed to a real failure? */
+	switch (err) {
+	case EXDEV:			// different filesystems.
+	case EMLINK:		// too many links already.
+	case EPERM:			// filesystem has no hard links, or policy.
+	case EOPNOTSUPP:	// no reflinks on this filesystem.
+#if ENOTSUP != EOPNOTSUPP
+	case ENOTSUP:
+#endif
+	case ENOTTY:		// no FICLONE ioctl here.
+	case EINVAL:		// reflink between incompatible files.
+	case ENOSYS:
+		return 1;
+	default:
+		return 0;
+	}
+} // cantshare()
+
+int
+gcdir(const char *dir, size_t *nobj, off_t *nbytes)
+{ /* storegc() for one of the store's subdirs. */
+	DIR *dp = opendir(dir);
+	if (!dp) return -1;
+	struct dirent *de;
+	while ((de = readdir(dp))) {
+		if (de->d_name[0] == '.') continue;
+		struct stat sb;
+		if (fstatat(dirfd(dp), de->d_name, &sb, AT_SYMLINK_NOFOLLOW)
+				== -1 || !S_ISREG(sb.st_mode) || sb.st_nlink > 1) {
+			continue;
+		}
+		if (unlinkat(dirfd(dp), de->d_name, 0) == 0) {
+			(*nobj)++;
+			*nbytes += sb.st_size;
+		}
+	}
+	closedir(dp);
+	return 0;
+} // gcdir()
+
+int
+cmpname(const void *a, const void *b)
+{ /* qsort() comparison for an array of names. */
+	return strcmp(*(char * const *)a, *(char * const *)b);
+} // cmpname()
+
+int
+listsrcs(const char *dir, char ***names, size_t *n)
+{ /* The .c and .h files in dir, sorted so that the hash of them does
+   * not depend on the order readdir() gives.
+  */
+	DIR *dp = opendir(dir);
+	if (!dp) return -1;
+	size_t cap = 16;
+	*n = 0;
+	*names = xmalloc(cap * sizeof(char *));
+	struct dirent *de;
+	while ((de = readdir(dp))) {
+		size_t len = strlen(de->d_name);
+		if (len < 3 || de->d_name[len - 2] != '.'
+				|| !strchr("ch", de->d_name[len - 1])) {
+			continue;
+		}
+		struct stat sb;
+		if (fstatat(dirfd(dp), de->d_name, &sb, 0) == -1
+				|| !S_ISREG(sb.st_mode)) {
+			continue;
+		}
+		if (*n == cap) {
+			cap *= 2;
+			*names = realloc(*names, cap * sizeof(char *));
+			if (!*names) {
+				fputs("Out of memory.\n", stderr);
+				exit(EXIT_FAILURE);
+			}
+		}
+		(*names)[(*n)++] = xstrdup(de->d_name);
+	}
+	closedir(dp);
+	qsort(*names, *n, sizeof(char *), cmpname);
+	return 0;
+} // listsrcs()
+
+int
+buildlib(const char *compdir, const char *flags, char **names, size_t n,
+			const char *tmp)
+{ /* Copy the sources into tmp and make libcomponents.a there from the
+   * .c files, compiling as many at once as there are CPUs. Those that
+   * fail are removed, the compiler's complaints about them are for when
+   * a project compiles them itself. The results are made read only as
+   * store objects are.
+  */
+	size_t i;
+	for (i = 0; i < n; i++) {
+		char src[PATH_MAX], dst[PATH_MAX];
+		if (snprintf(src, PATH_MAX, "%s/%s", compdir, names[i]) >= PATH_MAX
+				|| snprintf(dst, PATH_MAX, "%s/%s", tmp, names[i])
+				>= PATH_MAX) {
+			errno = ENAMETOOLONG;
+			return -1;
+		}
+		if (copyin(src, dst) == -1) return -1;
+	}
+	char *cc = (getenv("CC")) ? getenv("CC") : "cc";
+	char *ar = (getenv("AR")) ? getenv("AR") : "ar";
+	char *fl = xstrdup((char *)flags);
+	size_t nw = 0;
+	const char *cp;
+	for (cp = flags; *cp; cp++) {	// words, an upper bound on tokens.
+		if (!isspace((unsigned char)*cp) && (cp == flags
+				|| isspace((unsigned char)cp[-1]))) nw++;
+	}
+	char **args = xmalloc((nw + 7) * sizeof(char *));	// cc and 6 more.
+	int nf = 0;
+	args[nf++] = cc;
+	char *tok, *save;
+	for (tok = strtok_r(fl, " \t", &save); tok;
+			tok = strtok_r(NULL, " \t", &save)) {
+		args[nf++] = tok;
+	}
+	args[nf++] = "-D_GNU_SOURCE=1";
+	args[nf++] = "-c";
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpu < 1) ncpu = 1;
+	pid_t *pids = xmalloc((n + 1) * sizeof(pid_t));
+	char **path = xmalloc((n + 1) * sizeof(char *));
+	char **objs = xmalloc((n + 4) * sizeof(char *));
+	objs[0] = ar;
+	objs[1] = "rcs";
+	objs[2] = xmalloc(strlen(tmp) + sizeof("/" LIBNAME));
+	sprintf(objs[2], "%s/" LIBNAME, tmp);
+	int nobj = 3;
+	long running = 0;
+	int res = 0;
+	size_t next = 0, done = 0;
+	/* Start compiles in order while there are CPUs free, and reap them
+	 * in the same order. Only our own pids are waited for, as other
+	 * threads may be running tools of their own.
+	*/
+	while (done < next || (res == 0 && next < n)) {
+		if (res == 0 && next < n && running < ncpu) {
+			pids[next] = 0;
+			path[next] = xmalloc(strlen(tmp) + strlen(names[next]) + 2);
+			sprintf(path[next], "%s/%s", tmp, names[next]);
+			size_t len = strlen(path[next]);
+			if (path[next][len - 1] == 'c') {
+				char obj[PATH_MAX];
+				strcpy(obj, path[next]);
+				obj[len - 1] = 'o';
+				args[nf] = path[next];
+				args[nf + 1] = "-o";
+				args[nf + 2] = obj;
+				args[nf + 3] = NULL;
+				if (runwait(args, &pids[next]) == -1) res = -1;
+				else running++;
+			}
+			next++;
+			continue;
+		}
+		pid_t pid = pids[done];
+		int status = 1;
+		if (pid) {
+			while (waitpid(pid, &status, 0) == -1 && errno == EINTR) ;
+			running--;
+			if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+				objs[nobj] = xstrdup(path[done]);
+				objs[nobj][strlen(objs[nobj]) - 1] = 'o';
+				nobj++;
+			} else {
+				unlink(path[done]);
+			}
+		}
+		done++;
+	}
+	objs[nobj] = NULL;
+	if (res == 0) {
+		int status;
+		pid_t pid;
+		if (runwait(objs, &pid) == -1
+				|| waitpid(pid, &status, 0) == -1) {
+			res = -1;
+		} else if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+			errno = EIO;
+			res = -1;
+		}
+	}
+	for (i = 3; i < (size_t)nobj; i++) {
+		unlink(objs[i]);
+		free(objs[i]);
+	}
+	for (i = 0; i < next; i++) free(path[i]);
+	vfree(objs[2], objs, path, pids, fl, args, NULL);
+	if (res == 0) {
+		DIR *dp = opendir(tmp);
+		if (!dp) return -1;
+		struct dirent *de;
+		while ((de = readdir(dp))) {
+			if (de->d_name[0] != '.') fchmodat(dirfd(dp), de->d_name,
+												0444, 0);
+		}
+		closedir(dp);
+	}
+	return res;
+} // buildlib()
+
+int
+runwait(char **argv, pid_t *pid)
+{ /* Start argv with stdout and stderr to /dev/null, for the caller to
+   * wait for as *pid.
+  */
+	*pid = fork();
+	if (*pid == -1) return -1;
+	if (*pid == 0) {
+		int fd = open("/dev/null", O_WRONLY);
+		if (fd != -1) {
+			dup2(fd, STDOUT_FILENO);
+			dup2(fd, STDERR_FILENO);
+		}
+		execvp(argv[0], argv);
+		_exit(127);
+	}
+	return 0;
+} // runwait()
+
+int
+copyin(const char *src, const char *dst)
+{ /* Copy src to the new file dst, sharing its blocks if it can. */
+	if (reflink(src, dst) == 0) return 0;
+	if (!cantshare(errno)) return -1;
+	int sfd = open(src, O_RDONLY | O_CLOEXEC);
+	if (sfd == -1) return -1;
+	int dfd = open(dst, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (dfd == -1) {
+		close(sfd);
+		return -1;
+	}
+	char buf[65536];
+	ssize_t got;
+	int res = 0;
+	while (res == 0 && (got = read(sfd, buf, sizeof(buf))) != 0) {
+		if (got == -1) {
+			if (errno != EINTR) res = -1;
+			continue;
+		}
+		if (write(dfd, buf, got) != got) res = -1;
+	}
+	close(sfd);
+	if (close(dfd) == -1) res = -1;
+	return res;
+} // copyin()
+
+int
+rmflat(const char *dir, size_t *nobj, off_t *nbytes)
+{ /* Remove dir and the files in it, it has no subdirs. The files and
+   * their bytes are counted into *nobj and *nbytes.
+  */
+	DIR *dp = opendir(dir);
+	if (!dp) return (errno == ENOENT) ? 0 : -1;
+	struct dirent *de;
+	while ((de = readdir(dp))) {
+		if (de->d_name[0] == '.') continue;
+		struct stat sb;
+		if (fstatat(dirfd(dp), de->d_name, &sb, AT_SYMLINK_NOFOLLOW) == 0
+				&& unlinkat(dirfd(dp), de->d_name, 0) == 0) {
+			(*nobj)++;
+			*nbytes += sb.st_size;
+		}
+	}
+	closedir(dp);
+	return rmdir(dir);
+} // rmflat()
+
+int
+gclibs(const char *dir, size_t *nobj, off_t *nbytes)
+{ /* storegc() for the versions of libcomponents.a in dir, a version
+   * goes when no project has a hard link to its library.
+  */
+	int lockfd = lockdir(dir, LOCK_EX);
+	if (lockfd == -1) return (errno == ENOENT) ? 0 : -1;
+	DIR *dp = opendir(dir);
+	if (!dp) {
+		close(lockfd);
+		return -1;
+	}
+	struct dirent *de;
+	while ((de = readdir(dp))) {
+		if (de->d_name[0] == '.') continue;
+		char lib[PATH_MAX];
+		if (snprintf(lib, PATH_MAX, "%s/%s/" LIBNAME, dir, de->d_name)
+				>= PATH_MAX) continue;
+		struct stat sb;
+		// a version still being built has none yet, so is passed over.
+		if (stat(lib, &sb) == -1 || sb.st_nlink > 1) continue;
+		*strrchr(lib, '/') = 0;
+		rmflat(lib, nobj, nbytes);
+	}
+	closedir(dp);
+	close(lockfd);
+	return 0;
+} // gclibs()
+
+int
+lockdir(const char *dir, int op)
+{ /* Open dir and flock() it with op, waiting for the lock. Returns the
+   * descriptor, closing it lets the lock go.
+  */
+	int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd == -1) return -1;
+	while (flock(fd, op) == -1) {
+		if (errno == EINTR) continue;
+		int err = errno;
+		close(fd);
+		errno = err;
+		return -1;
+	}
+	return fd;
+} // lockdir()
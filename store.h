@@ -0,0 +1,50 @@
+/*    store.h
+ *
+ * Copyright 2017 Robert L (Bob) Parker rlp1938@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+/* The purpose of store.[h|c] is to keep one copy of files that are the
+ * same in every project, such as install-sh and COPYING, in a content
+ * addressed store, $HOME/.cache/newprogram/store. Projects get hard
+ * links or reflinks to the stored copy. The components are kept there
+ * compiled too, as versions of libcomponents.a. Functions here return
+ * -1 and set errno on error, they don't exit(). complib() returns a
+ * descriptor to close() when done with the version it names.
+ * */
+#ifndef _STORE_H
+#define _STORE_H
+#include "str.h"
+#include "files.h"
+#include "dirs.h"
+
+int
+storein(const char *path, int hardok);
+
+int
+storegc(size_t *nobj, off_t *nbytes);
+
+int
+complib(const char *compdir, const char *flags, char *libdir);
+
+int
+reflink(const char *src, const char *target);
+
+int
+cantshare(int err);
+
+#endif
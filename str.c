@@ -88,29 +88,12 @@ meminsert(const char *line, mdata *dd, size_t meminc)
 	if (safelen > (unsigned)(dd->limit - dd->to)) { // >= 0 always
 		/* Ensure that line always has room to fit. */
 		size_t needed = (meminc > safelen) ? meminc : safelen;
-		memresize(dd, needed);
+		memgrow(dd, needed);
 	}
 	strcpy(dd->to, line);
 	dd->to += len+1;
 } // meminsert()
 
-/* There's a bug in memreplace(). It manifests as dofopen() segfaulting
- * when run immediately after a run of memreplace(). dofopen() should
- * never segfault, it can and should abort when there is some problem
- * with the file it's trying to open. So I am clobbering some memory, I
- * suppose with some kind of write beyond my malloc'd space.
- *
- * The problem happens when available space is == space needed or
- * available space is 1 more than space needed.
- * If available space is 1 less than needed, a resize is forced and all
- * is well. If available space is 2 more than needed it works as well.
- *
- * If I am off by 1 somewhere I can't see where. Is memmove() doing
- * something it shouldn't oughta?
- *
- * Workaround - I'll put an 8 byte fudge fence into the thing.
- * */
-
 int
 printstrlist(char **list)
 {
@@ -123,38 +106,63 @@ printstrlist(char **list)
 
 void
 memreplace(mdata *md, char *find, char *repl, off_t meminc)
-{/* Replace find with repl for every occurrence in the data block md. */
-	size_t flen = strlen(find);
-	size_t rlen = strlen(repl);
-	off_t ldiff = rlen - flen;
-	const off_t fudge_fence = 8;	// see bug commentary above.
-	char *fp = md->fro;
-	fp = memmem(fp, md->to - fp, find, flen);
-	while (fp) {
-		off_t avail = md->limit - md->to;
-		if (ldiff + fudge_fence > avail) {
-			off_t fpoffset = fp - md->fro;	// Handle relocation.
-			// Ensure that the resized memory has space to fit new data.
-			off_t actualinc = (meminc > ldiff)
-								? meminc : ldiff + fudge_fence;
-			/* Ensure that we never have available space within 0 or 1
-			 * bytes of the needed space. */
-			memresize(md, actualinc);
-			fp = md->fro + fpoffset;
+{/* Replace find with repl for every occurrence in the data block md.
+  * The result is put together in one pass by renderiov(), in place if
+  * it is no longer than what was there, otherwise in a new block with
+  * meminc bytes to spare. repl may contain find, it is not looked at
+  * again.
+ */
+	iolist_t il = {0};
+	char *finds[] = {find, NULL};
+	renderiov(&il, md->fro, md->to, finds, &repl);
+	size_t len = md->to - md->fro;
+	if (il.len <= len) {	// each piece of md moves down, if at all.
+		char *dst = md->fro;
+		size_t i;
+		for (i = 0; i < il.n; i++) {
+			memmove(dst, il.iov[i].iov_base, il.iov[i].iov_len);
+			dst += il.iov[i].iov_len;
 		}
-		char *movefro = fp + flen;
-		char *moveto = fp + rlen;
-		size_t mlen = md->to - fp;
-		memmove(moveto, movefro, mlen);
-		memcpy(fp, repl, rlen);
-		md->to += ldiff;
-		fp = memmem(fp, md->to - fp, find, flen);
-	} // while(fp)
+		md->to = dst;
+	} else {
+		size_t spare = lenrequired((meminc > 0) ? meminc : 0);
+		char *fro = xmalloc(il.len + spare);
+		md->to = iolgather(&il, fro);
+		free(md->fro);
+		md->fro = fro;
+		md->limit = md->to + spare;
+	}
+	if (md->to < md->limit) *md->to = 0;
+	freeiol(&il);
 } // memreplace()
 
+void
+memgrow(mdata *dd, size_t need)
+{	/* Make room for at least need more bytes after dd->to. The block at
+	 * least doubles each time, so a run of small additions costs
+	 * amortised O(1) each, and the new space is not zeroed, use
+	 * memresize() for that. glibc's realloc() grows the large blocks
+	 * that it has mmap()'d with mremap(), so they don't get copied.
+	*/
+	size_t avail = dd->limit - dd->to;
+	if (need <= avail) return;
+	size_t now = dd->limit - dd->fro;
+	size_t dlen = dd->to - dd->fro;
+	size_t newsize = (now < MD_MINSIZE / 2) ? MD_MINSIZE : 2 * now;
+	if (newsize < dlen + need) newsize = dlen + need;
+	char *p = realloc(dd->fro, newsize);
+	if (!p) {
+		fputs("Out of memory\n", stderr);
+		exit(EXIT_FAILURE);
+	}
+	dd->fro = p;
+	dd->to = p + dlen;
+	dd->limit = p + newsize;
+} // memgrow()
+
 void
 memresize(mdata *dd, off_t change)
-{	/* Alter the the size of a malloc'd memory block.
+{	/* Alter the the size of a malloc'd memory block by exactly change.
 	 * Takes care of any relocation of the original pointer.
 	 * Writes 0 over the new space when increasing size.
 	 * Handles memory allocation failure.
@@ -265,9 +273,7 @@ void
 
 char
 *getcfgdata(mdata *cfdat, char *cfgid)
-{/* Read selected line */
-	static char buf[NAME_MAX];
-	buf[0] = 0;
+{/* Return the value of the selected line, in malloc()'d memory. */
 	char *cp = cfdat->fro;
 	size_t slen = strlen(cfgid);
 	cp = memmem(cp, cfdat->to - cp, cfgid, slen);
@@ -282,12 +288,10 @@ char
 	}
 	cp++;	// step past '='
 	char *ep = memchr(cp, '\n', cfdat->to - cp);
-	if (!cp) {
-		fprintf(stderr, "WTF??? no line feed in config: %s\n", cfgid);
-		exit(EXIT_FAILURE);
-	}
+	if (!ep) ep = cfdat->to;	// last line, no line feed.
 	size_t dlen = ep - cp;
-	strncpy(buf, cp, dlen);
+	char *buf = xmalloc(dlen + 1);
+	memcpy(buf, cp, dlen);
 	buf[dlen] = 0;
 	return buf;
 } // getgfgdata()
@@ -386,7 +390,7 @@ destroystrarray(char **wordlist, size_t count)
 */
 	size_t i = 0;
 	if (count) {
-		for (i = 0; i < count; i++) free(wordlist[count]);
+		for (i = 0; i < count; i++) free(wordlist[i]);
 	} else {
 		while (wordlist[i]) {
 			free(wordlist[i]);
@@ -432,3 +436,137 @@ char
 	res[n] = (char *)NULL;
 	return res;
 }
+
+lineidx_t
+*mklineidx(const char *fro, const char *to)
+{ /* Index the lines from fro up to to in one memchr() pass, which the C
+   * library does a word or a vector at a time. Nothing in the block is
+   * changed. A last line without a '\n' is counted.
+  */
+	lineidx_t *li = xmalloc(sizeof(lineidx_t));
+	li->base = fro;
+	li->n = 0;
+	size_t cap = (to - fro) / 32 + 16;	// guess, doubled when short.
+	li->line = xmalloc(cap * sizeof(lineent_t));
+	const char *cp = fro;
+	while (cp < to) {
+		const char *nl = memchr(cp, '\n', to - cp);
+		if (!nl) nl = to;
+		if (li->n == cap) {
+			cap *= 2;
+			li->line = realloc(li->line, cap * sizeof(lineent_t));
+			if (!li->line) {
+				fputs("Out of memory.\n", stderr);
+				exit(EXIT_FAILURE);
+			}
+		}
+		li->line[li->n].off = cp - fro;
+		li->line[li->n].len = nl - cp;
+		li->n++;
+		cp = nl + 1;
+	}
+	return li;
+} // mklineidx()
+
+const char
+*lineat(const lineidx_t *li, size_t i, size_t *len)
+{ /* Line i, counting from 0, and its length without the '\n' into len.
+   * The line is not '\0' terminated. NULL when i is past the last line,
+   * so for (i = 0; (p = lineat(li, i, &len)); i++) visits them all.
+  */
+	if (i >= li->n) return NULL;
+	*len = li->line[i].len;
+	return li->base + li->line[i].off;
+} // lineat()
+
+void
+freelineidx(lineidx_t *li)
+{ /* Frees the index only, the block belongs to the caller. */
+	free(li->line);
+	free(li);
+} // freelineidx()
+
+void
+ioladd(iolist_t *il, const char *p, size_t len)
+{ /* Append len bytes at p to il. p is not copied so it must outlive
+   * il. A piece that follows on from the last one just extends it.
+  */
+	if (!len) return;
+	il->len += len;
+	if (il->n) {
+		struct iovec *last = &il->iov[il->n - 1];
+		if ((char *)last->iov_base + last->iov_len == p) {
+			last->iov_len += len;
+			return;
+		}
+	}
+	if (il->n == il->cap) {
+		il->cap = (il->cap) ? 2 * il->cap : 16;
+		il->iov = realloc(il->iov, il->cap * sizeof(struct iovec));
+		if (!il->iov) {
+			fputs("Out of memory.\n", stderr);
+			exit(EXIT_FAILURE);
+		}
+	}
+	il->iov[il->n].iov_base = (void *)p;
+	il->iov[il->n].iov_len = len;
+	il->n++;
+} // ioladd()
+
+void
+renderiov(iolist_t *il, const char *fro, const char *to, char **find,
+			char **repl)
+{ /* Append the template fro..to to il with each occurrence of find[i]
+   * replaced by repl[i], find being NULL terminated. It is one pass, so
+   * unlike a run of memreplace() the replacements are not searched
+   * again. Where two finds start at the same place the earlier wins.
+   * Both the template and the replacements must outlive il.
+  */
+	size_t nf;
+	for (nf = 0; find[nf]; nf++) ;
+	const char **next = xmalloc(nf * sizeof(char *));	// NULL, no more.
+	size_t i;
+	for (i = 0; i < nf; i++) {
+		next[i] = memmem(fro, to - fro, find[i], strlen(find[i]));
+	}
+	const char *cp = fro;
+	while (1) {
+		size_t which = nf;
+		for (i = 0; i < nf; i++) {
+			if (next[i] && next[i] < cp) {	// overlapped by the last.
+				next[i] = memmem(cp, to - cp, find[i], strlen(find[i]));
+			}
+			if (next[i] && (which == nf || next[i] < next[which])) {
+				which = i;
+			}
+		}
+		if (which == nf) break;
+		ioladd(il, cp, next[which] - cp);
+		ioladd(il, repl[which], strlen(repl[which]));
+		cp = next[which] + strlen(find[which]);
+		next[which] = memmem(cp, to - cp, find[which], strlen(find[which]));
+	}
+	ioladd(il, cp, to - cp);
+	free(next);
+} // renderiov()
+
+char
+*iolgather(const iolist_t *il, char *dst)
+{ /* Copy the pieces of il to dst, which must have room for il->len
+   * bytes. Returns the end of what was copied.
+  */
+	size_t i;
+	for (i = 0; i < il->n; i++) {
+		if (!il->iov[i].iov_len) continue;
+		memcpy(dst, il->iov[i].iov_base, il->iov[i].iov_len);
+		dst += il->iov[i].iov_len;
+	}
+	return dst;
+} // iolgather()
+
+void
+freeiol(iolist_t *il)
+{ /* Frees the list only, the pieces belong to the caller. */
+	free(il->iov);
+	memset(il, 0, sizeof(iolist_t));
+} // freeiol()
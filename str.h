@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
@@ -41,12 +42,37 @@
 #include <libgen.h>
 #include <errno.h>
 
+#define MD_MINSIZE 256	// the smallest block memgrow() makes.
+
+/* An mdata block always comes from malloc(), its users free() and
+ * realloc() fro themselves, so there is no small buffer inside the
+ * struct for short blocks to start in. Nor does memgrow() call mremap(),
+ * glibc's realloc() does that for blocks over its mmap() threshold. */
+
 typedef struct mdata {
 	char *fro;
 	char *to;
 	char *limit;
 } mdata;
 
+typedef struct lineent_t {	/* one line of a block, see mklineidx() */
+	size_t off;			// of its first byte from the start of the block.
+	size_t len;			// not counting its '\n'.
+} lineent_t;
+
+typedef struct lineidx_t {	/* the lines of a block that is left as it is */
+	const char *base;	// the block, which may be mmap()'d read only.
+	lineent_t *line;	// line[i] for i < n.
+	size_t n;
+} lineidx_t;
+
+typedef struct iolist_t {	/* output as pieces of other buffers */
+	struct iovec *iov;	// iov[i] for i < n, nothing is copied.
+	size_t n;
+	size_t cap;
+	size_t len;			// bytes in all the pieces.
+} iolist_t;
+
 int
 printstrlist(char **list);
 
@@ -74,6 +100,9 @@ meminsert(const char *line, mdata *md, size_t meminc);
 void
 memreplace(mdata *md, char *find , char *repl, off_t meminc);
 
+void
+memgrow(mdata *md, size_t need);
+
 void
 memresize(mdata *md, off_t meminc);
 
@@ -113,4 +142,26 @@ in_uch_array(const unsigned char, unsigned char *);
 char
 **memblocktoarray(mdata *md, int n);
 
+lineidx_t
+*mklineidx(const char *fro, const char *to);
+
+const char
+*lineat(const lineidx_t *li, size_t i, size_t *len);
+
+void
+freelineidx(lineidx_t *li);
+
+void
+ioladd(iolist_t *il, const char *p, size_t len);
+
+void
+renderiov(iolist_t *il, const char *fro, const char *to, char **find,
+			char **repl);
+
+char
+*iolgather(const iolist_t *il, char *dst);
+
+void
+freeiol(iolist_t *il);
+
 #endif
@@ -0,0 +1,570 @@
+/*    stubs.c
+ *
+ * Copyright 2017 Robert L (Bob) Parker rlp1938@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+/* The purpose of stubs.[h|c] is to hand out the stubs and config file
+ * newprogram works from. The defaults are compiled in, see embed.h, a
+ * file of the same name in $HOME/.config/newprogram overrides one.
+ *
+ * The overrides and the parsed prdata.cfg are kept together in one
+ * file, $HOME/.cache/newprogram/bundle, which is mmap()'d at startup.
+ * It records the mtime and size of the config dir, and is remade when
+ * those change or newprogram is built with other stubs. Saving a file
+ * by rename(), as most editors do, changes the dir; a file rewritten
+ * in place does not, touch the dir then.
+ *
+ * Each stub comes with marks, the offsets of each "%s" in it and each
+ * "target" that ends a comment, as noted by mkembed.sh or findmarks(),
+ * so that renderstub() looks for placeholders only there.
+ * */
+
+#include <stdint.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include "stubs.h"
+
+#define BUNDLE_MAGIC "NPBNDL2\n"
+
+typedef struct bhead {		/* start of the bundle */
+	char magic[8];
+	uint64_t embedsum;		// checksum of the built in stubs.
+	int64_t dirsec;			// mtime of the config dir, -1 if none.
+	int64_t dirnsec;
+	int64_t dirsize;
+	uint32_t nstubs;		// bstub records following bhead.
+	uint32_t ncfg;			// bcfg records following those.
+} bhead;
+
+typedef struct bstub {		/* an override held in the bundle */
+	char name[64];
+	uint64_t off;			// content, '\0' terminated, from bundle.
+	uint64_t len;
+	uint64_t marks;			// its unsigned marks, from bundle.
+	uint64_t nmarks;
+} bstub;
+
+typedef struct bcfg {		/* a key=value line of prdata.cfg */
+	uint64_t key;			// offsets of '\0' terminated strings.
+	uint64_t val;
+} bcfg;
+
+static const embed_t *findembedded(const char *name);
+static void stubdata(const char *name, const char **data, size_t *len,
+						const unsigned **marks, size_t *nmarks);
+static void findmarks(const char *data, size_t len, mdata *out);
+static void havebundle(void);
+static void loadbundle(void);
+static int bundleok(const char *blob, size_t len);
+static int strinblob(const char *blob, size_t len, uint64_t off);
+static void makebundle(void);
+static void parsecfg(mdata *cfg, mdata *out, bcfg **kv, uint32_t *nkv);
+static void addmissingcfg(mdata *out, bcfg **kv, uint32_t *nkv);
+static void memappend(mdata *md, const char *p, size_t len);
+static char *cfgdirpath(char *buf, const char *name);
+static char *bundlepath(char *buf);
+
+static char *bundle;		// the bundle, mmap()'d or malloc()'d.
+static size_t bundlelen;
+static int mapped;
+static pthread_mutex_t bundlelock = PTHREAD_MUTEX_INITIALIZER;
+
+mdata
+*getstub(const char *name)
+{ /* Return the content of the stub called name, from the config dir if
+   * the user has a copy there, else the built in one.
+  */
+	const char *data;
+	size_t len;
+	stubdata(name, &data, &len, NULL, NULL);
+	mdata *md = init_mdata();
+	md->fro = xmalloc(len + 1);
+	memcpy(md->fro, data, len + 1);
+	md->to = md->fro + len;
+	md->limit = md->to + 1;
+	return md;
+} // getstub()
+
+void
+renderstub(iolist_t *il, const char *name, char **find, char **repl)
+{ /* As renderiov() for the stub called name, but with no copy or search
+   * of it. Each find is looked for only at the marks, which it must
+   * hold one of, else the stub is searched after all. The pieces are in
+   * the stubs, il must be written before freestubs().
+  */
+	const char *data;
+	size_t len, nmarks;
+	const unsigned *marks;
+	stubdata(name, &data, &len, &marks, &nmarks);
+	size_t nf, i;
+	for (nf = 0; find[nf]; nf++) ;
+	size_t *at = xmalloc((nf + 1) * sizeof(size_t));	// of the mark.
+	size_t *flen = xmalloc((nf + 1) * sizeof(size_t));
+	for (i = 0; i < nf; i++) {
+		const char *cp = strstr(find[i], "%s");
+		if (!cp) cp = strstr(find[i], "target */");
+		if (!cp) {
+			vfree(at, flen, NULL);
+			renderiov(il, data, data + len, find, repl);
+			return;
+		}
+		at[i] = cp - find[i];
+		flen[i] = strlen(find[i]);
+	}
+	size_t done = 0, m;
+	for (m = 0; m < nmarks; m++) {
+		size_t which = nf, start = 0;
+		for (i = 0; i < nf; i++) {
+			if (marks[m] < at[i] || marks[m] >= len) continue;
+			size_t st = marks[m] - at[i];
+			if (st < done || flen[i] > len - st
+					|| memcmp(data + st, find[i], flen[i]) != 0) continue;
+			if (which == nf || st < start) {	// the earlier wins ties.
+				which = i;
+				start = st;
+			}
+		}
+		if (which == nf) continue;
+		ioladd(il, data + done, start - done);
+		ioladd(il, repl[which], strlen(repl[which]));
+		done = start + flen[which];
+	}
+	ioladd(il, data + done, len - done);
+	vfree(at, flen, NULL);
+} // renderstub()
+
+const char
+*getcfg(const char *key)
+{ /* Return the value of key in prdata.cfg, NULL if it has none. */
+	havebundle();
+	bhead *bh = (bhead *)bundle;
+	bcfg *kv = (bcfg *)(bundle + sizeof(bhead)
+						+ bh->nstubs * sizeof(bstub));
+	uint32_t i;
+	for (i = 0; i < bh->ncfg; i++) {
+		if (strcmp(bundle + kv[i].key, key) == 0) {
+			return bundle + kv[i].val;
+		}
+	}
+	return NULL;
+} // getcfg()
+
+void
+freestubs(void)
+{ /* Let go of the bundle, the next stub or cfg wanted reloads it. Not
+   * while any other thread may be using stubs.
+  */
+	if (!bundle) return;
+	if (mapped) {
+		munmap(bundle, bundlelen);
+	} else {
+		free(bundle);
+	}
+	bundle = NULL;
+} // freestubs()
+
+void
+checkstubs(void)
+{ /* For long running callers: load the bundle if it isn't, drop and
+   * reload it if the files it was made from have changed since.
+  */
+	if (bundle && !bundleok(bundle, bundlelen)) freestubs();
+	if (!bundle) loadbundle();
+} // checkstubs()
+
+void
+stub2file(const char *name, const char *path)
+{ /* Write the stub called name to path. */
+	mdata *md = getstub(name);
+	writefile(path, md->fro, md->to, "w");
+	free_mdata(md);
+} // stub2file()
+
+int
+installstubs(void)
+{ /* Put copies of the built in stubs into the config dir for the user
+   * to edit. Files already there are left alone. Returns the number of
+   * files written.
+  */
+	char path[PATH_MAX];
+	sprintf(path, "%s/.config", getenv("HOME"));
+	newdir(path, 1);
+	newdir(cfgdirpath(path, NULL), 1);
+	int count = 0;
+	const embed_t *ep;
+	for (ep = embedded; ep->name; ep++) {
+		if (exists_file(cfgdirpath(path, ep->name))) continue;
+		writefile(path, (char *)ep->data, (char *)ep->data + ep->len,
+					"w");
+		count++;
+	}
+	return count;
+} // installstubs()
+
+const embed_t
+*findembedded(const char *name)
+{
+	const embed_t *ep;
+	for (ep = embedded; ep->name; ep++) {
+		if (strcmp(ep->name, name) == 0) return ep;
+	}
+	return NULL;
+} // findembedded()
+
+void
+stubdata(const char *name, const char **data, size_t *len,
+			const unsigned **marks, size_t *nmarks)
+{ /* Where the stub called name is and its marks, in the bundle if the
+   * user has a copy else built in. marks may be NULL.
+  */
+	const embed_t *ep = findembedded(name);
+	if (!ep) {
+		fprintf(stderr, "No such stub: %s\n", name);
+		exit(EXIT_FAILURE);
+	}
+	havebundle();
+	*data = ep->data;
+	*len = ep->len;
+	if (marks) {
+		*marks = ep->marks;
+		*nmarks = ep->nmarks;
+	}
+	bhead *bh = (bhead *)bundle;
+	bstub *bs = (bstub *)(bundle + sizeof(bhead));
+	uint32_t i;
+	for (i = 0; i < bh->nstubs; i++) {
+		if (strcmp(bs[i].name, name) == 0) {
+			*data = bundle + bs[i].off;
+			*len = bs[i].len;
+			if (marks) {
+				*marks = (const unsigned *)(bundle + bs[i].marks);
+				*nmarks = bs[i].nmarks;
+			}
+			return;
+		}
+	}
+} // stubdata()
+
+void
+findmarks(const char *data, size_t len, mdata *out)
+{ /* Append the marks of data to out, as mkembed.sh does for the built in
+   * stubs.
+  */
+	size_t i;
+	for (i = 0; i + 1 < len; i++) {
+		if ((data[i] == '%' && data[i + 1] == 's') || (data[i] == 't'
+				&& len - i >= 9 && memcmp(data + i, "target */", 9) == 0)) {
+			unsigned m = i;
+			memappend(out, (const char *)&m, sizeof(m));
+		}
+	}
+} // findmarks()
+
+void
+havebundle(void)
+{ /* Load the bundle if it isn't, only once when threads race to it. */
+	pthread_mutex_lock(&bundlelock);
+	if (!bundle) loadbundle();
+	pthread_mutex_unlock(&bundlelock);
+} // havebundle()
+
+void
+loadbundle(void)
+{ /* Map the bundle if it is up to date, otherwise make a new one. */
+	char path[PATH_MAX];
+	int fd = open(bundlepath(path), O_RDONLY);
+	if (fd != -1) {
+		struct stat sb;
+		if (fstat(fd, &sb) == 0 && (size_t)sb.st_size >= sizeof(bhead)) {
+			void *p = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE,
+							fd, 0);
+			if (p != MAP_FAILED) {
+				if (bundleok(p, sb.st_size)) {
+					bundle = p;
+					bundlelen = sb.st_size;
+					mapped = 1;
+					close(fd);
+					return;
+				}
+				munmap(p, sb.st_size);
+			}
+		}
+		close(fd);
+	}
+	makebundle();
+} // loadbundle()
+
+int
+bundleok(const char *blob, size_t len)
+{ /* Return 1 if blob is a bundle made from the files as they are now,
+   * as far as one stat() of the config dir can tell.
+  */
+	const bhead *bh = (const bhead *)blob;
+	if (len < sizeof(bhead)) return 0;
+	if (memcmp(bh->magic, BUNDLE_MAGIC, 8) != 0) return 0;
+	if (bh->embedsum != embedsum) return 0;	// newprogram rebuilt.
+	// A truncated or corrupt file must not send anyone past the map.
+	if (bh->nstubs > len / sizeof(bstub)
+			|| bh->ncfg > len / sizeof(bcfg)) return 0;
+	size_t tablen = sizeof(bhead) + bh->nstubs * sizeof(bstub)
+					+ bh->ncfg * sizeof(bcfg);
+	if (tablen > len) return 0;
+	const bstub *bs = (const bstub *)(blob + sizeof(bhead));
+	const bcfg *bc = (const bcfg *)(bs + bh->nstubs);
+	uint32_t i;
+	for (i = 0; i < bh->nstubs; i++) {
+		if (!memchr(bs[i].name, 0, sizeof(bs[i].name))) return 0;
+		if (bs[i].off < tablen || bs[i].off >= len
+				|| bs[i].len >= len - bs[i].off
+				|| blob[bs[i].off + bs[i].len] != 0) return 0;
+		// renderstub() checks each mark against the stub's length.
+		if (bs[i].marks < tablen || bs[i].marks % sizeof(unsigned)
+				|| bs[i].marks > len
+				|| bs[i].nmarks > (len - bs[i].marks) / sizeof(unsigned)) {
+			return 0;
+		}
+	}
+	for (i = 0; i < bh->ncfg; i++) {
+		if (!strinblob(blob, len, bc[i].key)
+				|| !strinblob(blob, len, bc[i].val)) return 0;
+	}
+	char path[PATH_MAX];
+	struct stat sb;
+	if (stat(cfgdirpath(path, NULL), &sb) == -1) {
+		return (bh->dirsec == -1);
+	}
+	return (bh->dirsec == sb.st_mtim.tv_sec
+			&& bh->dirnsec == sb.st_mtim.tv_nsec
+			&& bh->dirsize == sb.st_size);
+} // bundleok()
+
+static int
+strinblob(const char *blob, size_t len, uint64_t off)
+{ /* Return 1 if a '\0' terminated string starts at off within blob. */
+	if (off >= len) return 0;
+	return memchr(blob + off, 0, len - off) != NULL;
+} // strinblob()
+
+void
+makebundle(void)
+{ /* Read the overrides and prdata.cfg, lay them out as a bundle and
+   * save it for next time. Failing to save it is not fatal, the bundle
+   * just stays in memory for this run.
+  */
+	size_t nemb;
+	for (nemb = 0; embedded[nemb].name; nemb++);
+	bstub *bs = xmalloc((nemb + 1) * sizeof(bstub));
+	memset(bs, 0, (nemb + 1) * sizeof(bstub));
+	mdata **content = xmalloc((nemb + 1) * sizeof(mdata *));
+	uint32_t nstubs = 0;
+	mdata *cfg = NULL;
+
+	bhead bh;
+	memset(&bh, 0, sizeof(bh));
+	memcpy(bh.magic, BUNDLE_MAGIC, 8);
+	bh.embedsum = embedsum;
+	bh.dirsec = -1;
+	char path[PATH_MAX];
+	struct stat sb;
+	DIR *dp = opendir(cfgdirpath(path, NULL));
+	if (dp) {
+		if (fstat(dirfd(dp), &sb) == 0) {
+			bh.dirsec = sb.st_mtim.tv_sec;
+			bh.dirnsec = sb.st_mtim.tv_nsec;
+			bh.dirsize = sb.st_size;
+		}
+		struct dirent *de;
+		while ((de = readdir(dp))) {
+			const embed_t *ep = findembedded(de->d_name);
+			if (!ep || strlen(ep->name) >= sizeof(bs->name)) continue;
+			if (stat(cfgdirpath(path, ep->name), &sb) == -1
+					|| !S_ISREG(sb.st_mode)) continue;
+			strcpy(bs[nstubs].name, ep->name);
+			content[nstubs] = readfile(path, 1, 1);	// '\0' terminated
+			if (strcmp(ep->name, "prdata.cfg") == 0) cfg = content[nstubs];
+			nstubs++;
+		}
+		doclosedir(dp);
+	}
+	bh.nstubs = nstubs;
+
+	// Strings go after the tables, offsets are from the bundle start.
+	mdata *strs = init_mdata();
+	mdata embcfg;
+	if (!cfg) {
+		const embed_t *ep = findembedded("prdata.cfg");
+		embcfg.fro = (char *)ep->data;
+		embcfg.to = embcfg.limit = (char *)ep->data + ep->len;
+		cfg = &embcfg;
+	}
+	bcfg *kv;
+	parsecfg(cfg, strs, &kv, &bh.ncfg);
+	if (cfg != &embcfg) addmissingcfg(strs, &kv, &bh.ncfg);
+	size_t tablen = sizeof(bhead) + nstubs * sizeof(bstub)
+					+ bh.ncfg * sizeof(bcfg);
+	uint32_t i;
+	for (i = 0; i < bh.ncfg; i++) {
+		kv[i].key += tablen;
+		kv[i].val += tablen;
+	}
+	for (i = 0; i < nstubs; i++) {
+		bs[i].len = content[i]->to - content[i]->fro;
+		bs[i].off = tablen + (strs->to - strs->fro);
+		memappend(strs, content[i]->fro, bs[i].len + 1);
+		// the marks after it, aligned as tablen is.
+		size_t pad = (strs->to - strs->fro) % sizeof(unsigned);
+		if (pad) memappend(strs, "\0\0\0", sizeof(unsigned) - pad);
+		bs[i].marks = tablen + (strs->to - strs->fro);
+		findmarks(content[i]->fro, bs[i].len, strs);
+		bs[i].nmarks = (tablen + (strs->to - strs->fro) - bs[i].marks)
+						/ sizeof(unsigned);
+		free_mdata(content[i]);
+	}
+
+	bundlelen = tablen + (strs->to - strs->fro);
+	bundle = xmalloc(bundlelen);
+	memcpy(bundle, &bh, sizeof(bh));
+	memcpy(bundle + sizeof(bh), bs, nstubs * sizeof(bstub));
+	memcpy(bundle + sizeof(bh) + nstubs * sizeof(bstub), kv,
+			bh.ncfg * sizeof(bcfg));
+	memcpy(bundle + tablen, strs->fro, strs->to - strs->fro);
+	mapped = 0;
+	vfree(bs, content, kv, NULL);
+	free_mdata(strs);
+
+	// Save it, replacing the old one in a single step.
+	sprintf(path, "%s/.cache", getenv("HOME"));
+	mkdir(path, 0775);
+	strjoin(path, '/', "newprogram", PATH_MAX);
+	mkdir(path, 0775);
+	char tmp[PATH_MAX + 32];
+	sprintf(tmp, "%s/bundle.%d", path, getpid());
+	int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1) return;
+	ssize_t done = write(fd, bundle, bundlelen);
+	if (close(fd) == 0 && done == (ssize_t)bundlelen) {
+		if (rename(tmp, bundlepath(path)) == 0) return;
+	}
+	unlink(tmp);
+} // makebundle()
+
+void
+parsecfg(mdata *cfg, mdata *out, bcfg **kv, uint32_t *nkv)
+{ /* Collect the key=value lines of cfg, skipping blank lines and
+   * comments. Keys and values are added to out, *kv gets their offsets
+   * within out.
+  */
+	size_t cap = 16, n = 0;
+	bcfg *res = xmalloc(cap * sizeof(bcfg));
+	char *cp = cfg->fro;
+	while (cp < cfg->to) {
+		char *eol = memchr(cp, '\n', cfg->to - cp);
+		if (!eol) eol = cfg->to;
+		char *eq = memchr(cp, '=', eol - cp);
+		if (*cp != '#' && eq && eq > cp) {
+			char line[PATH_MAX];
+			size_t klen = eq - cp, vlen = eol - eq - 1;
+			if (klen + vlen + 1 < PATH_MAX) {
+				if (n == cap) {
+					cap *= 2;
+					res = realloc(res, cap * sizeof(bcfg));
+					if (!res) {
+						fputs("Out of memory.\n", stderr);
+						exit(EXIT_FAILURE);
+					}
+				}
+				memcpy(line, cp, klen);
+				line[klen] = 0;
+				trimspace(line);
+				res[n].key = out->to - out->fro;
+				meminsert(line, out, NAME_MAX);
+				memcpy(line, eq + 1, vlen);
+				line[vlen] = 0;
+				trimspace(line);
+				res[n].val = out->to - out->fro;
+				meminsert(line, out, NAME_MAX);
+				n++;
+			}
+		}
+		cp = eol + 1;
+	}
+	*kv = res;
+	*nkv = n;
+} // parsecfg()
+
+static void
+addmissingcfg(mdata *out, bcfg **kv, uint32_t *nkv)
+{ /* Add to *kv the keys of the built in prdata.cfg that the user's copy
+   * lacks, as a copy made by an older newprogram will. Every default
+   * value then lives in prdata.cfg alone.
+  */
+	const embed_t *ep = findembedded("prdata.cfg");
+	mdata embcfg, *strs = init_mdata();
+	embcfg.fro = (char *)ep->data;
+	embcfg.to = embcfg.limit = (char *)ep->data + ep->len;
+	bcfg *ekv;
+	uint32_t nekv, i, j, n = *nkv;
+	parsecfg(&embcfg, strs, &ekv, &nekv);
+	bcfg *res = realloc(*kv, (n + nekv) * sizeof(bcfg));
+	if (!res) {
+		fputs("Out of memory.\n", stderr);
+		exit(EXIT_FAILURE);
+	}
+	for (i = 0; i < nekv; i++) {
+		const char *key = strs->fro + ekv[i].key;
+		for (j = 0; j < *nkv; j++) {
+			if (strcmp(out->fro + res[j].key, key) == 0) break;
+		}
+		if (j < *nkv) continue;
+		const char *val = strs->fro + ekv[i].val;
+		res[n].key = out->to - out->fro;
+		memappend(out, key, strlen(key) + 1);
+		res[n].val = out->to - out->fro;
+		memappend(out, val, strlen(val) + 1);
+		n++;
+	}
+	free(ekv);
+	free_mdata(strs);
+	*kv = res;
+	*nkv = n;
+} // addmissingcfg()
+
+void
+memappend(mdata *md, const char *p, size_t len)
+{ /* meminsert() for data that may hold '\0'. */
+	memgrow(md, len);
+	memcpy(md->to, p, len);
+	md->to += len;
+} // memappend()
+
+char
+*cfgdirpath(char *buf, const char *name)
+{ /* Path of name in the config dir, or of the dir if name is NULL. buf
+   * is PATH_MAX.
+  */
+	sprintf(buf, "%s/.config/newprogram", getenv("HOME"));
+	if (name) strjoin(buf, '/', (char *)name, PATH_MAX);
+	return buf;
+} // cfgdirpath()
+
+char
+*bundlepath(char *buf)
+{
+	sprintf(buf, "%s/.cache/newprogram/bundle", getenv("HOME"));
+	return buf;
+} // bundlepath()
@@ -0,0 +1,57 @@
+/*    stubs.h
+ *
+ * Copyright 2017 Robert L (Bob) Parker rlp1938@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+/* The purpose of stubs.[h|c] is to hand out the stubs and config file
+ * newprogram works from. The defaults are compiled in, see embed.h, a
+ * file of the same name in $HOME/.config/newprogram overrides one.
+ * Overrides and the parsed prdata.cfg are cached in a single file,
+ * $HOME/.cache/newprogram/bundle.
+ * getstub() and getcfg() may be called from several threads at once,
+ * freestubs() and checkstubs() only when no other thread is using them.
+ * */
+#ifndef _STUBS_H
+#define _STUBS_H
+#include "str.h"
+#include "files.h"
+#include "dirs.h"
+#include "embed.h"
+
+mdata
+*getstub(const char *name);
+
+void
+renderstub(iolist_t *il, const char *name, char **find, char **repl);
+
+const char
+*getcfg(const char *key);
+
+void
+freestubs(void);
+
+void
+checkstubs(void);
+
+void
+stub2file(const char *name, const char *path);
+
+int
+installstubs(void);
+
+#endif
@@ -0,0 +1,262 @@
+/*    tar.c
+ *
+ * Copyright 2017 Robert L (Bob) Parker rlp1938@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+/* Symbolic links are followed, so a component that is a symlink goes
+ * in the archive as the file it points to. Only regular files and
+ * directories are archived, autom4te.cache is left out as autoconf
+ * makes it again when it is wanted. Members that come from memory are
+ * owned by the caller, made now, with mode 0644 or 0755 for a dir.
+ * */
+
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <linux/limits.h>
+#include "tar.h"
+
+#define TBLOCK 512
+
+typedef struct ustar_t {	/* POSIX.1-1988 header, one block */
+	char name[100];
+	char mode[8];
+	char uid[8];
+	char gid[8];
+	char size[12];
+	char mtime[12];
+	char chksum[8];
+	char typeflag;
+	char linkname[100];
+	char magic[6];
+	char version[2];
+	char uname[32];
+	char gname[32];
+	char devmajor[8];
+	char devminor[8];
+	char prefix[155];
+	char pad[12];
+} ustar_t;
+
+static int tarent(FILE *fp, const char *path, const char *name);
+static int header(FILE *fp, const char *name, const struct stat *sb);
+static int setname(ustar_t *h, const char *name);
+static void octal(char *field, size_t len, unsigned long long val);
+static int tarfile(FILE *fp, const char *path, const struct stat *sb);
+static int skip(const struct dirent *de);
+static void memstat(struct stat *sb, mode_t mode, off_t size);
+
+int
+tarpath(FILE *fp, const char *path, const char *name)
+{ /* Write path to fp as name, and if it is a dir everything under it
+   * named name/..., as tar -C dirname(path) -c name would if path were
+   * called name. Call tarend() after the last member.
+  */
+	return tarent(fp, path, name);
+} // tarpath()
+
+int
+tarmkdir(FILE *fp, const char *name)
+{ /* The member for dir name, which ends in '/'. */
+	struct stat sb;
+	memstat(&sb, S_IFDIR | 0755, 0);
+	return header(fp, name, &sb);
+} // tarmkdir()
+
+int
+tariov(FILE *fp, const char *name, const struct iovec *iov, size_t n,
+		size_t len)
+{ /* The member for file name, its content the n pieces of iov which
+   * are len bytes in all.
+  */
+	struct stat sb;
+	memstat(&sb, S_IFREG | 0644, len);
+	if (header(fp, name, &sb) == -1) return -1;
+	size_t i;
+	for (i = 0; i < n; i++) {
+		if (fwrite(iov[i].iov_base, 1, iov[i].iov_len, fp) !=
+				iov[i].iov_len) return -1;
+	}
+	static const char zero[TBLOCK];
+	size_t pad = (TBLOCK - len % TBLOCK) % TBLOCK;
+	if (fwrite(zero, 1, pad, fp) != pad) return -1;
+	return 0;
+} // tariov()
+
+int
+tarend(FILE *fp)
+{ /* The two zero blocks that end an archive. */
+	static const char zero[2 * TBLOCK];
+	if (fwrite(zero, 1, sizeof(zero), fp) != sizeof(zero)) return -1;
+	return fflush(fp);
+} // tarend()
+
+int
+tarent(FILE *fp, const char *path, const char *name)
+{ /* Archive path as name, and if it is a dir its entries in name order
+   * so that the same tree always makes the same archive.
+  */
+	struct stat sb;
+	if (stat(path, &sb) == -1) return -1;
+	if (S_ISREG(sb.st_mode)) {
+		if (header(fp, name, &sb) == -1) return -1;
+		return tarfile(fp, path, &sb);
+	}
+	if (!S_ISDIR(sb.st_mode)) return 0;
+	char dname[PATH_MAX];
+	if (snprintf(dname, sizeof(dname), "%s/", name) >= PATH_MAX) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	if (header(fp, dname, &sb) == -1) return -1;
+	struct dirent **list;
+	int n = scandir(path, &list, skip, alphasort);
+	if (n == -1) return -1;
+	int i, res = 0;
+	for (i = 0; i < n; i++) {
+		char sub[PATH_MAX], subname[PATH_MAX];
+		if (res == 0) {
+			if (snprintf(sub, sizeof(sub), "%s/%s", path,
+						list[i]->d_name) >= PATH_MAX ||
+				snprintf(subname, sizeof(subname), "%s%s", dname,
+						list[i]->d_name) >= PATH_MAX) {
+				errno = ENAMETOOLONG;
+				res = -1;
+			} else {
+				res = tarent(fp, sub, subname);
+			}
+		}
+		free(list[i]);
+	}
+	free(list);
+	return res;
+} // tarent()
+
+void
+memstat(struct stat *sb, mode_t mode, off_t size)
+{ /* What header() needs for a member that is not on disk. */
+	memset(sb, 0, sizeof(*sb));
+	sb->st_mode = mode;
+	sb->st_uid = getuid();
+	sb->st_gid = getgid();
+	sb->st_size = size;
+	sb->st_mtim.tv_sec = time(NULL);
+} // memstat()
+
+int
+skip(const struct dirent *de)
+{ /* scandir() filter, 0 for entries that are not archived. */
+	const char *n = de->d_name;
+	if (strcmp(n, ".") == 0 || strcmp(n, "..") == 0) return 0;
+	return strcmp(n, "autom4te.cache") != 0;
+} // skip()
+
+int
+header(FILE *fp, const char *name, const struct stat *sb)
+{ /* The header block for name, which ends in '/' for a dir. */
+	ustar_t h;
+	memset(&h, 0, sizeof(h));
+	if (setname(&h, name) == -1) return -1;
+	octal(h.mode, sizeof(h.mode), sb->st_mode & 07777);
+	octal(h.uid, sizeof(h.uid), sb->st_uid);
+	octal(h.gid, sizeof(h.gid), sb->st_gid);
+	int isdir = S_ISDIR(sb->st_mode);
+	octal(h.size, sizeof(h.size), (isdir) ? 0 : sb->st_size);
+	octal(h.mtime, sizeof(h.mtime), sb->st_mtim.tv_sec);
+	h.typeflag = (isdir) ? '5' : '0';
+	memcpy(h.magic, "ustar", 6);
+	memcpy(h.version, "00", 2);
+	// the checksum is taken with its own field as spaces.
+	memset(h.chksum, ' ', sizeof(h.chksum));
+	unsigned sum = 0;
+	size_t i;
+	for (i = 0; i < sizeof(h); i++) sum += ((unsigned char *)&h)[i];
+	octal(h.chksum, 7, sum);
+	if (fwrite(&h, 1, sizeof(h), fp) != sizeof(h)) return -1;
+	return 0;
+} // header()
+
+int
+setname(ustar_t *h, const char *name)
+{ /* name goes in h->name if it fits, else split at a '/' between
+   * h->prefix and h->name.
+  */
+	size_t len = strlen(name);
+	if (len <= sizeof(h->name)) {
+		memcpy(h->name, name, len);
+		return 0;
+	}
+	// the '/' that splits them belongs to neither field.
+	const char *sl = name + len - sizeof(h->name) - 1;
+	if (sl < name) sl = name;
+	while (*sl && *sl != '/') sl++;
+	if (!*sl || (size_t)(sl - name) > sizeof(h->prefix) || !sl[1]) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	memcpy(h->prefix, name, sl - name);
+	memcpy(h->name, sl + 1, len - (sl - name) - 1);
+	return 0;
+} // setname()
+
+void
+octal(char *field, size_t len, unsigned long long val)
+{ /* val as len - 1 octal digits and a '\0'. */
+	field[--len] = 0;
+	while (len--) {
+		field[len] = '0' + (val & 7);
+		val >>= 3;
+	}
+} // octal()
+
+int
+tarfile(FILE *fp, const char *path, const struct stat *sb)
+{ /* The content of path, padded to a whole block. The size is already
+   * in the header so a file that changes under us is an error.
+  */
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) return -1;
+	char buf[65536];
+	off_t left = sb->st_size;
+	while (left) {
+		size_t want = (left < (off_t)sizeof(buf)) ? (size_t)left : sizeof(buf);
+		ssize_t got = read(fd, buf, want);
+		if (got == -1 && errno == EINTR) continue;
+		if (got <= 0) {
+			if (got == 0) errno = EIO;	// shrank under us.
+			close(fd);
+			return -1;
+		}
+		if (fwrite(buf, 1, got, fp) != (size_t)got) {
+			close(fd);
+			return -1;
+		}
+		left -= got;
+	}
+	close(fd);
+	static const char zero[TBLOCK];
+	size_t pad = (TBLOCK - sb->st_size % TBLOCK) % TBLOCK;
+	if (fwrite(zero, 1, pad, fp) != pad) return -1;
+	return 0;
+} // tarfile()
@@ -0,0 +1,45 @@
+/*    tar.h
+ *
+ * Copyright 2017 Robert L (Bob) Parker rlp1938@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+*/
+
+/* The purpose of tar.[h|c] is to write a directory tree, or files held
+ * in memory, to a stream as a POSIX (ustar) tar archive, without making
+ * the archive on disk.
+ * Functions here return -1 and set errno on error, they don't exit().
+ * */
+#ifndef _TAR_H
+#define _TAR_H
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+int
+tarpath(FILE *fp, const char *path, const char *name);
+
+int
+tarmkdir(FILE *fp, const char *name);
+
+int
+tariov(FILE *fp, const char *name, const struct iovec *iov, size_t n,
+		size_t len);
+
+int
+tarend(FILE *fp);
+
+#endif
@@ -0,0 +1,11 @@
+
+# Unity build. `make unity` builds exe%s from exe%s-unity.c, which
+# includes each of its sources, as one translation unit. So no two of
+# them may have static names in common. Other targets build an object
+# per source as usual unless given exe%s_OBJECTS as unity does.
+CLEANFILES=exe%s-unity.c
+.PHONY: unity
+unity: exe%s-unity.c
+	$(MAKE) $(AM_MAKEFLAGS) exe%s_OBJECTS=exe%s-unity.$(OBJEXT)
+exe%s-unity.c: Makefile
+	printf '#include "%s"\n' $(exe%s_SOURCES) > $@